@@ -0,0 +1,550 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONVERT_X86
+#endif
+
+#include <til.h>
+#include <til_fb.h>
+
+#include "convert.h"
+
+/* Conversion of 32bpp xRGB frames into I420, NV12, or packed RGB24.
+ *
+ * The frame is split into tiles and converted in parallel by libtil's
+ * threads, by way of a private module rendered with til_module_render().
+ * Tiles are a multiple of two in both dimensions so 2x2 chroma blocks never
+ * straddle tiles, only the frame's right and bottom edges may be odd, where
+ * the last column/row is replicated.
+ *
+ * The SIMD row kernels use the exact same integer arithmetic as the scalar
+ * ones, so their output is bit-identical regardless of which gets dispatched.
+ */
+
+#define CONVERT_TILE_SIZE	64
+
+#define CONVERT_R(_p)	(((_p) >> 16) & 0xff)
+#define CONVERT_G(_p)	(((_p) >> 8) & 0xff)
+#define CONVERT_B(_p)	((_p) & 0xff)
+
+typedef struct convert_kernels_t {
+	/* each returns how many pixels it converted, the scalar kernels finish the rest */
+	unsigned	(*y_row)(const uint32_t *src, uint8_t *y, unsigned n);
+	unsigned	(*uv_row)(const uint32_t *src0, const uint32_t *src1, uint8_t *u, uint8_t *v, unsigned step, unsigned n);
+	unsigned	(*rgb24_row)(const uint32_t *src, uint8_t *dst, unsigned n);
+} convert_kernels_t;
+
+typedef struct convert_context_t {
+	convert_format_t		format;
+	const convert_dst_t		*dst;
+	const convert_kernels_t		*kernels;
+} convert_context_t;
+
+
+static inline uint8_t convert_y(unsigned r, unsigned g, unsigned b)
+{
+	return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+
+static inline uint8_t convert_u(int r, int g, int b)
+{
+	return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+
+static inline uint8_t convert_v(int r, int g, int b)
+{
+	return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+
+static void convert_y_row_scalar(const uint32_t *src, uint8_t *y, unsigned i, unsigned n)
+{
+	for (; i < n; i++)
+		y[i] = convert_y(CONVERT_R(src[i]), CONVERT_G(src[i]), CONVERT_B(src[i]));
+}
+
+
+/* i and n are in source pixels, i must be even */
+static void convert_uv_row_scalar(const uint32_t *src0, const uint32_t *src1, uint8_t *u, uint8_t *v, unsigned step, unsigned i, unsigned n)
+{
+	for (; i < n; i += 2) {
+		unsigned	j = i + 1 < n ? i + 1 : i;
+		int		r, g, b;
+
+		r = (CONVERT_R(src0[i]) + CONVERT_R(src0[j]) + CONVERT_R(src1[i]) + CONVERT_R(src1[j]) + 2) >> 2;
+		g = (CONVERT_G(src0[i]) + CONVERT_G(src0[j]) + CONVERT_G(src1[i]) + CONVERT_G(src1[j]) + 2) >> 2;
+		b = (CONVERT_B(src0[i]) + CONVERT_B(src0[j]) + CONVERT_B(src1[i]) + CONVERT_B(src1[j]) + 2) >> 2;
+
+		u[(i >> 1) * step] = convert_u(r, g, b);
+		v[(i >> 1) * step] = convert_v(r, g, b);
+	}
+}
+
+
+static void convert_rgb24_row_scalar(const uint32_t *src, uint8_t *dst, unsigned i, unsigned n)
+{
+	for (; i < n; i++) {
+		dst[i * 3] = CONVERT_R(src[i]);
+		dst[i * 3 + 1] = CONVERT_G(src[i]);
+		dst[i * 3 + 2] = CONVERT_B(src[i]);
+	}
+}
+
+
+/* the "vectorized" kernels of the scalar fallback convert nothing, leaving it all to the scalar kernels */
+static unsigned convert_none_y_row(const uint32_t *src, uint8_t *y, unsigned n)
+{
+	return 0;
+}
+
+
+static unsigned convert_none_uv_row(const uint32_t *src0, const uint32_t *src1, uint8_t *u, uint8_t *v, unsigned step, unsigned n)
+{
+	return 0;
+}
+
+
+static unsigned convert_none_rgb24_row(const uint32_t *src, uint8_t *dst, unsigned n)
+{
+	return 0;
+}
+
+
+static const convert_kernels_t	convert_kernels_scalar = {
+	.y_row = convert_none_y_row,
+	.uv_row = convert_none_uv_row,
+	.rgb24_row = convert_none_rgb24_row,
+};
+
+
+#ifdef CONVERT_X86
+
+/* Pixels are unpacked to 16-bit B, G, R, X words, and pmaddwd against
+ * (b, g, r, 0) coefficients leaves b*B + g*G and r*R in adjacent dwords,
+ * summed by adding the qword shifted down 32 bits.
+ */
+
+/* luma of 4 pixels as 4 int32 */
+static inline __m128i convert_sse2_y4(__m128i px)
+{
+	const __m128i	zero = _mm_setzero_si128();
+	const __m128i	coef = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+	__m128i		lo, hi;
+
+	lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coef);
+	hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coef);
+	lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+	hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+	lo = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+				_mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+	lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_set1_epi32(128)), 8);
+
+	return _mm_add_epi32(lo, _mm_set1_epi32(16));
+}
+
+
+/* 2x2 averages of 4 pixels from each of two rows, as two 16-bit BGRX pixels */
+static inline __m128i convert_sse2_avg2x2(__m128i px0, __m128i px1)
+{
+	const __m128i	zero = _mm_setzero_si128();
+	__m128i		lo, hi, s;
+
+	lo = _mm_add_epi16(_mm_unpacklo_epi8(px0, zero), _mm_unpacklo_epi8(px1, zero));
+	hi = _mm_add_epi16(_mm_unpackhi_epi8(px0, zero), _mm_unpackhi_epi8(px1, zero));
+	lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+	hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+	s = _mm_unpacklo_epi64(lo, hi);
+
+	return _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+}
+
+
+/* chroma of two averaged 16-bit BGRX pixels as int32 in dwords 0 and 2 */
+static inline __m128i convert_sse2_c2(__m128i avg, __m128i coef)
+{
+	__m128i	m;
+
+	m = _mm_madd_epi16(avg, coef);
+	m = _mm_add_epi32(m, _mm_srli_epi64(m, 32));
+	m = _mm_srai_epi32(_mm_add_epi32(m, _mm_set1_epi32(128)), 8);
+
+	return _mm_add_epi32(m, _mm_set1_epi32(128));
+}
+
+
+/* store 4 int32 chroma values each of u4 and v4 */
+static inline void convert_sse2_store_uv4(__m128i u4, __m128i v4, uint8_t *u, uint8_t *v, unsigned step)
+{
+	__m128i	uv = _mm_packs_epi32(u4, v4);
+
+	if (step == 2 && v == u + 1) {
+		uv = _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8));
+		_mm_storel_epi64((__m128i *)u, _mm_packus_epi16(uv, uv));
+	} else if (step == 1) {
+		uint32_t	u32, v32;
+
+		uv = _mm_packus_epi16(uv, uv);
+		u32 = _mm_cvtsi128_si32(uv);
+		v32 = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+		memcpy(u, &u32, sizeof(u32));
+		memcpy(v, &v32, sizeof(v32));
+	} else {
+		uint8_t	tmp[16];
+
+		_mm_storeu_si128((__m128i *)tmp, _mm_packus_epi16(uv, uv));
+		for (unsigned i = 0; i < 4; i++) {
+			u[i * step] = tmp[i];
+			v[i * step] = tmp[4 + i];
+		}
+	}
+}
+
+
+static unsigned convert_sse2_y_row(const uint32_t *src, uint8_t *y, unsigned n)
+{
+	unsigned	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i	y8;
+
+		y8 = _mm_packs_epi32(convert_sse2_y4(_mm_loadu_si128((const __m128i *)&src[i])),
+				     convert_sse2_y4(_mm_loadu_si128((const __m128i *)&src[i + 4])));
+		_mm_storel_epi64((__m128i *)&y[i], _mm_packus_epi16(y8, y8));
+	}
+
+	return i;
+}
+
+
+static unsigned convert_sse2_uv_row(const uint32_t *src0, const uint32_t *src1, uint8_t *u, uint8_t *v, unsigned step, unsigned n)
+{
+	const __m128i	ucoef = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+	const __m128i	vcoef = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+	unsigned	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i	a01, a23, u4, v4;
+
+		a01 = convert_sse2_avg2x2(_mm_loadu_si128((const __m128i *)&src0[i]),
+					  _mm_loadu_si128((const __m128i *)&src1[i]));
+		a23 = convert_sse2_avg2x2(_mm_loadu_si128((const __m128i *)&src0[i + 4]),
+					  _mm_loadu_si128((const __m128i *)&src1[i + 4]));
+
+		u4 = _mm_unpacklo_epi64(_mm_shuffle_epi32(convert_sse2_c2(a01, ucoef), _MM_SHUFFLE(3, 3, 2, 0)),
+					_mm_shuffle_epi32(convert_sse2_c2(a23, ucoef), _MM_SHUFFLE(3, 3, 2, 0)));
+		v4 = _mm_unpacklo_epi64(_mm_shuffle_epi32(convert_sse2_c2(a01, vcoef), _MM_SHUFFLE(3, 3, 2, 0)),
+					_mm_shuffle_epi32(convert_sse2_c2(a23, vcoef), _MM_SHUFFLE(3, 3, 2, 0)));
+
+		convert_sse2_store_uv4(u4, v4, &u[(i >> 1) * step], &v[(i >> 1) * step], step);
+	}
+
+	return i;
+}
+
+
+static const convert_kernels_t	convert_kernels_sse2 = {
+	.y_row = convert_sse2_y_row,
+	.uv_row = convert_sse2_uv_row,
+	.rgb24_row = convert_none_rgb24_row,	/* packing bytes wants pshufb, which SSE2 lacks */
+};
+
+
+/* The AVX2 kernels are the SSE2 ones widened, 256-bit unpacks and packs
+ * operate per 128-bit lane so results need permuting back into order.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i convert_avx2_y8(__m256i px)
+{
+	const __m256i	zero = _mm256_setzero_si256();
+	const __m256i	coef = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0);
+	__m256i		lo, hi;
+
+	lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), coef);
+	hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), coef);
+	lo = _mm256_add_epi32(lo, _mm256_srli_epi64(lo, 32));
+	hi = _mm256_add_epi32(hi, _mm256_srli_epi64(hi, 32));
+	lo = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+				   _mm256_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+	lo = _mm256_srai_epi32(_mm256_add_epi32(lo, _mm256_set1_epi32(128)), 8);
+
+	return _mm256_add_epi32(lo, _mm256_set1_epi32(16));
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i convert_avx2_avg2x2(__m256i px0, __m256i px1)
+{
+	const __m256i	zero = _mm256_setzero_si256();
+	__m256i		lo, hi, s;
+
+	lo = _mm256_add_epi16(_mm256_unpacklo_epi8(px0, zero), _mm256_unpacklo_epi8(px1, zero));
+	hi = _mm256_add_epi16(_mm256_unpackhi_epi8(px0, zero), _mm256_unpackhi_epi8(px1, zero));
+	lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+	hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+	s = _mm256_unpacklo_epi64(lo, hi);
+
+	return _mm256_srli_epi16(_mm256_add_epi16(s, _mm256_set1_epi16(2)), 2);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i convert_avx2_c2(__m256i avg, __m256i coef)
+{
+	__m256i	m;
+
+	m = _mm256_madd_epi16(avg, coef);
+	m = _mm256_add_epi32(m, _mm256_srli_epi64(m, 32));
+	m = _mm256_srai_epi32(_mm256_add_epi32(m, _mm256_set1_epi32(128)), 8);
+
+	return _mm256_add_epi32(m, _mm256_set1_epi32(128));
+}
+
+
+__attribute__((target("avx2")))
+static unsigned convert_avx2_y_row(const uint32_t *src, uint8_t *y, unsigned n)
+{
+	unsigned	i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m256i	y16;
+
+		y16 = _mm256_packs_epi32(convert_avx2_y8(_mm256_loadu_si256((const __m256i *)&src[i])),
+					 convert_avx2_y8(_mm256_loadu_si256((const __m256i *)&src[i + 8])));
+		y16 = _mm256_permute4x64_epi64(y16, _MM_SHUFFLE(3, 1, 2, 0));
+		y16 = _mm256_packus_epi16(y16, y16);
+		y16 = _mm256_permute4x64_epi64(y16, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)&y[i], _mm256_castsi256_si128(y16));
+	}
+
+	return i;
+}
+
+
+__attribute__((target("avx2")))
+static unsigned convert_avx2_uv_row(const uint32_t *src0, const uint32_t *src1, uint8_t *u, uint8_t *v, unsigned step, unsigned n)
+{
+	const __m256i	ucoef = _mm256_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0);
+	const __m256i	vcoef = _mm256_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0);
+	const __m256i	order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+	unsigned	i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m256i	a0, a1, u8, v8;
+
+		/* lanes of a0 hold chroma 0,1 | 2,3, a1 4,5 | 6,7 */
+		a0 = convert_avx2_avg2x2(_mm256_loadu_si256((const __m256i *)&src0[i]),
+					 _mm256_loadu_si256((const __m256i *)&src1[i]));
+		a1 = convert_avx2_avg2x2(_mm256_loadu_si256((const __m256i *)&src0[i + 8]),
+					 _mm256_loadu_si256((const __m256i *)&src1[i + 8]));
+
+		u8 = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(convert_avx2_c2(a0, ucoef), _MM_SHUFFLE(3, 3, 2, 0)),
+					   _mm256_shuffle_epi32(convert_avx2_c2(a1, ucoef), _MM_SHUFFLE(3, 3, 2, 0)));
+		v8 = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(convert_avx2_c2(a0, vcoef), _MM_SHUFFLE(3, 3, 2, 0)),
+					   _mm256_shuffle_epi32(convert_avx2_c2(a1, vcoef), _MM_SHUFFLE(3, 3, 2, 0)));
+		u8 = _mm256_permutevar8x32_epi32(u8, order);
+		v8 = _mm256_permutevar8x32_epi32(v8, order);
+
+		convert_sse2_store_uv4(_mm256_castsi256_si128(u8), _mm256_castsi256_si128(v8),
+				       &u[(i >> 1) * step], &v[(i >> 1) * step], step);
+		convert_sse2_store_uv4(_mm256_extracti128_si256(u8, 1), _mm256_extracti128_si256(v8, 1),
+				       &u[((i >> 1) + 4) * step], &v[((i >> 1) + 4) * step], step);
+	}
+
+	return i;
+}
+
+
+__attribute__((target("avx2")))
+static unsigned convert_avx2_rgb24_row(const uint32_t *src, uint8_t *dst, unsigned n)
+{
+	const __m256i	shuf = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+						2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	unsigned	i;
+
+	/* each lane's 16-byte store spills 4 bytes into the next pixels, so stop
+	 * while there are still two more pixels to absorb the final spill.
+	 */
+	for (i = 0; i + 10 <= n; i += 8) {
+		__m256i	rgb = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)&src[i]), shuf);
+
+		_mm_storeu_si128((__m128i *)&dst[i * 3], _mm256_castsi256_si128(rgb));
+		_mm_storeu_si128((__m128i *)&dst[i * 3 + 12], _mm256_extracti128_si256(rgb, 1));
+	}
+
+	return i;
+}
+
+
+static const convert_kernels_t	convert_kernels_avx2 = {
+	.y_row = convert_avx2_y_row,
+	.uv_row = convert_avx2_uv_row,
+	.rgb24_row = convert_avx2_rgb24_row,
+};
+
+#endif /* CONVERT_X86 */
+
+
+/* returns the kernels for isa, or NULL if this cpu doesn't support it */
+static const convert_kernels_t * convert_kernels(convert_isa_t isa)
+{
+	switch (isa) {
+	case CONVERT_ISA_AUTO:
+#ifdef CONVERT_X86
+		if (__builtin_cpu_supports("avx2"))
+			return &convert_kernels_avx2;
+
+		if (__builtin_cpu_supports("sse2"))
+			return &convert_kernels_sse2;
+#endif
+		return &convert_kernels_scalar;
+
+	case CONVERT_ISA_SCALAR:
+		return &convert_kernels_scalar;
+
+#ifdef CONVERT_X86
+	case CONVERT_ISA_SSE2:
+		return __builtin_cpu_supports("sse2") ? &convert_kernels_sse2 : NULL;
+
+	case CONVERT_ISA_AVX2:
+		return __builtin_cpu_supports("avx2") ? &convert_kernels_avx2 : NULL;
+#endif
+
+	default:
+		return NULL;
+	}
+}
+
+
+static int convert_fragmenter(void *context, const til_fb_fragment_t *fragment, unsigned number, til_fb_fragment_t *res_fragment)
+{
+	return til_fb_fragment_tile_single(fragment, CONVERT_TILE_SIZE, number, res_fragment);
+}
+
+
+static void convert_prepare_frame(void *context, unsigned ticks, unsigned n_cpus, til_fb_fragment_t *fragment, til_fragmenter_t *res_fragmenter)
+{
+	*res_fragmenter = convert_fragmenter;
+}
+
+
+static void convert_render_fragment(void *context, unsigned ticks, unsigned cpu, til_fb_fragment_t *fragment)
+{
+	convert_context_t		*ctxt = context;
+	const convert_kernels_t		*k = ctxt->kernels;
+	const convert_dst_t		*dst = ctxt->dst;
+	unsigned			w = fragment->width, h = fragment->height;
+
+#define SRC_ROW(_y)	((const uint32_t *)((const uint8_t *)fragment->buf + (_y) * fragment->pitch))
+
+	switch (ctxt->format) {
+	case CONVERT_FORMAT_RGB24:
+		for (unsigned y = 0; y < h; y++) {
+			uint8_t	*d = dst->planes[0] + (fragment->y + y) * dst->pitches[0] + fragment->x * 3;
+
+			convert_rgb24_row_scalar(SRC_ROW(y), d, k->rgb24_row(SRC_ROW(y), d, w), w);
+		}
+		break;
+
+	case CONVERT_FORMAT_I420:
+	case CONVERT_FORMAT_NV12: {
+		unsigned	step = ctxt->format == CONVERT_FORMAT_NV12 ? 2 : 1;
+
+		for (unsigned y = 0; y < h; y++) {
+			uint8_t	*d = dst->planes[0] + (fragment->y + y) * dst->pitches[0] + fragment->x;
+
+			convert_y_row_scalar(SRC_ROW(y), d, k->y_row(SRC_ROW(y), d, w), w);
+		}
+
+		for (unsigned y = 0; y < h; y += 2) {
+			const uint32_t	*src0 = SRC_ROW(y), *src1 = SRC_ROW(y + 1 < h ? y + 1 : y);
+			unsigned	cy = (fragment->y + y) >> 1, cx = fragment->x >> 1;
+			uint8_t		*u, *v;
+
+			if (step == 2) {
+				u = dst->planes[1] + cy * dst->pitches[1] + cx * 2;
+				v = u + 1;
+			} else {
+				u = dst->planes[1] + cy * dst->pitches[1] + cx;
+				v = dst->planes[2] + cy * dst->pitches[2] + cx;
+			}
+
+			convert_uv_row_scalar(src0, src1, u, v, step, k->uv_row(src0, src1, u, v, step, w), w);
+		}
+		break;
+	}
+
+	default:
+		assert(0);
+	}
+
+#undef SRC_ROW
+}
+
+
+static til_module_t	convert_module = {
+	.prepare_frame = convert_prepare_frame,
+	.render_fragment = convert_render_fragment,
+	.name = "convert",
+	.description = "Pixel format conversion (built-in)",
+};
+
+
+/* convert frame into the planes of dst using isa's kernels, respecting
+ * frame's stride and pitch, parallelized across tiles on libtil's threads.
+ *
+ * libtil has a single thread pool, and til_module_render() expects to be its
+ * only user at a time.  So this must not run concurrently with any other
+ * til_module_render(), including glimmer_thread()'s: call it from the render
+ * thread between frames.  Concurrent convert_frame() callers serialize among
+ * themselves.
+ */
+int convert_frame_isa(convert_isa_t isa, convert_format_t format, til_fb_fragment_t *frame, const convert_dst_t *dst)
+{
+	static pthread_mutex_t	mutex = PTHREAD_MUTEX_INITIALIZER;
+	convert_context_t	ctxt = {
+					.format = format,
+					.dst = dst,
+					.kernels = convert_kernels(isa),
+				};
+
+	assert(frame);
+	assert(dst);
+
+	if (!ctxt.kernels)
+		return -ENOTSUP;
+
+	pthread_mutex_lock(&mutex);
+	til_module_render(&convert_module, &ctxt, 0, frame);
+	pthread_mutex_unlock(&mutex);
+
+	return 0;
+}
+
+
+void convert_frame(convert_format_t format, til_fb_fragment_t *frame, const convert_dst_t *dst)
+{
+	convert_frame_isa(CONVERT_ISA_AUTO, format, frame, dst);
+}
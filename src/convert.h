@@ -0,0 +1,36 @@
+#ifndef _CONVERT_H
+#define _CONVERT_H
+
+#include <stdint.h>
+
+#include <til_fb.h>
+
+/* pixel format conversion of 32bpp xRGB frames for consumers outside the gtk window.
+ * Nothing in glimmer consumes it yet, so only convert_test links it for now.
+ */
+
+typedef enum convert_format_t {
+	CONVERT_FORMAT_I420,	/* planar Y, U, V; 4:2:0 BT.601 limited range */
+	CONVERT_FORMAT_NV12,	/* planar Y, interleaved UV; 4:2:0 BT.601 limited range */
+	CONVERT_FORMAT_RGB24,	/* packed R, G, B bytes */
+} convert_format_t;
+
+typedef enum convert_isa_t {
+	CONVERT_ISA_AUTO,	/* the fastest the cpu supports */
+	CONVERT_ISA_SCALAR,
+	CONVERT_ISA_SSE2,
+	CONVERT_ISA_AVX2,
+} convert_isa_t;
+
+/* destination planes, only as many as the format uses are accessed.
+ * Pitches are in bytes, chroma planes are (width + 1) / 2 x (height + 1) / 2.
+ */
+typedef struct convert_dst_t {
+	uint8_t		*planes[3];
+	unsigned	pitches[3];
+} convert_dst_t;
+
+void convert_frame(convert_format_t format, til_fb_fragment_t *frame, const convert_dst_t *dst);
+int convert_frame_isa(convert_isa_t isa, convert_format_t format, til_fb_fragment_t *frame, const convert_dst_t *dst);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <til.h>
+#include <til_fb.h>
+
+#include "convert.h"
+
+/* Checks every SIMD kernel set against the scalar one byte for byte, over
+ * odd frame sizes and padded source and destination pitches, then times
+ * each kernel set on a full HD frame.
+ */
+
+#define PADDING		40	/* bytes of padding per row, in both source and destination */
+#define SENTINEL	0xa5	/* destination fill, catches stray and missing writes alike */
+#define BENCH_WIDTH	1920
+#define BENCH_HEIGHT	1080
+#define BENCH_FRAMES	100
+
+static const struct {
+	convert_isa_t	isa;
+	const char	*name;
+} isas[] = {
+	{ CONVERT_ISA_SCALAR, "scalar" },
+	{ CONVERT_ISA_SSE2, "sse2" },
+	{ CONVERT_ISA_AVX2, "avx2" },
+};
+
+static const struct {
+	convert_format_t	format;
+	const char		*name;
+} formats[] = {
+	{ CONVERT_FORMAT_I420, "i420" },
+	{ CONVERT_FORMAT_NV12, "nv12" },
+	{ CONVERT_FORMAT_RGB24, "rgb24" },
+};
+
+static const unsigned sizes[][2] = {
+	{ 1, 1 },
+	{ 2, 2 },
+	{ 7, 3 },
+	{ 17, 9 },
+	{ 63, 65 },
+	{ 130, 66 },
+	{ 333, 127 },
+	{ 640, 480 },
+};
+
+
+typedef struct frame_t {
+	til_fb_fragment_t	fragment;
+	uint8_t			*buf;
+} frame_t;
+
+typedef struct planes_t {
+	convert_dst_t		dst;
+	uint8_t			*buf;
+	size_t			size;
+} planes_t;
+
+
+static int frame_init(frame_t *frame, unsigned width, unsigned height)
+{
+	unsigned	pitch = width * 4 + PADDING;
+
+	frame->buf = malloc(pitch * height);
+	if (!frame->buf)
+		return -ENOMEM;
+
+	for (unsigned i = 0; i < pitch * height; i++)
+		frame->buf[i] = rand();
+
+	frame->fragment = (til_fb_fragment_t){
+				.buf = (uint32_t *)frame->buf,
+				.width = width,
+				.height = height,
+				.frame_width = width,
+				.frame_height = height,
+				.stride = PADDING,
+				.pitch = pitch,
+			};
+
+	return 0;
+}
+
+
+static int planes_init(planes_t *planes, convert_format_t format, unsigned width, unsigned height)
+{
+	unsigned	cw = (width + 1) / 2, ch = (height + 1) / 2;
+	size_t		sizes[3] = {};
+	uint8_t		*p;
+
+	memset(planes, 0, sizeof(*planes));
+
+	switch (format) {
+	case CONVERT_FORMAT_I420:
+		planes->dst.pitches[0] = width + PADDING;
+		planes->dst.pitches[1] = planes->dst.pitches[2] = cw + PADDING;
+		sizes[0] = planes->dst.pitches[0] * height;
+		sizes[1] = sizes[2] = planes->dst.pitches[1] * ch;
+		break;
+
+	case CONVERT_FORMAT_NV12:
+		planes->dst.pitches[0] = width + PADDING;
+		planes->dst.pitches[1] = cw * 2 + PADDING;
+		sizes[0] = planes->dst.pitches[0] * height;
+		sizes[1] = planes->dst.pitches[1] * ch;
+		break;
+
+	case CONVERT_FORMAT_RGB24:
+		planes->dst.pitches[0] = width * 3 + PADDING;
+		sizes[0] = planes->dst.pitches[0] * height;
+		break;
+	}
+
+	planes->size = sizes[0] + sizes[1] + sizes[2];
+	planes->buf = malloc(planes->size);
+	if (!planes->buf)
+		return -ENOMEM;
+
+	memset(planes->buf, SENTINEL, planes->size);
+	p = planes->buf;
+	for (int i = 0; i < 3; i++) {
+		planes->dst.planes[i] = sizes[i] ? p : NULL;
+		p += sizes[i];
+	}
+
+	return 0;
+}
+
+
+static double now_ms(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+
+static int check(void)
+{
+	int	failures = 0;
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+		frame_t	frame;
+
+		if (frame_init(&frame, sizes[s][0], sizes[s][1]) < 0)
+			return -ENOMEM;
+
+		for (unsigned f = 0; f < sizeof(formats) / sizeof(*formats); f++) {
+			planes_t	ref;
+
+			if (planes_init(&ref, formats[f].format, sizes[s][0], sizes[s][1]) < 0)
+				return -ENOMEM;
+
+			convert_frame_isa(CONVERT_ISA_SCALAR, formats[f].format, &frame.fragment, &ref.dst);
+
+			for (unsigned i = 1; i < sizeof(isas) / sizeof(*isas); i++) {
+				planes_t	out;
+
+				if (planes_init(&out, formats[f].format, sizes[s][0], sizes[s][1]) < 0)
+					return -ENOMEM;
+
+				if (convert_frame_isa(isas[i].isa, formats[f].format, &frame.fragment, &out.dst) == -ENOTSUP) {
+					free(out.buf);
+					continue;
+				}
+
+				if (memcmp(ref.buf, out.buf, ref.size)) {
+					fprintf(stderr, "FAIL: %s %s %ux%u differs from scalar\n",
+						isas[i].name, formats[f].name, sizes[s][0], sizes[s][1]);
+					failures++;
+				}
+
+				free(out.buf);
+			}
+
+			free(ref.buf);
+		}
+
+		free(frame.buf);
+	}
+
+	return failures;
+}
+
+
+static int bench(void)
+{
+	frame_t	frame;
+
+	if (frame_init(&frame, BENCH_WIDTH, BENCH_HEIGHT) < 0)
+		return -ENOMEM;
+
+	for (unsigned f = 0; f < sizeof(formats) / sizeof(*formats); f++) {
+		for (unsigned i = 0; i < sizeof(isas) / sizeof(*isas); i++) {
+			planes_t	out;
+			double		start;
+
+			if (planes_init(&out, formats[f].format, BENCH_WIDTH, BENCH_HEIGHT) < 0)
+				return -ENOMEM;
+
+			/* warm up, and skip unsupported isas */
+			if (convert_frame_isa(isas[i].isa, formats[f].format, &frame.fragment, &out.dst) == -ENOTSUP) {
+				printf("%-6s %-6s unsupported\n", formats[f].name, isas[i].name);
+				free(out.buf);
+				continue;
+			}
+
+			start = now_ms();
+			for (unsigned n = 0; n < BENCH_FRAMES; n++)
+				convert_frame_isa(isas[i].isa, formats[f].format, &frame.fragment, &out.dst);
+
+			printf("%-6s %-6s %ux%u: %.3fms/frame\n",
+				formats[f].name, isas[i].name, BENCH_WIDTH, BENCH_HEIGHT,
+				(now_ms() - start) / BENCH_FRAMES);
+
+			free(out.buf);
+		}
+	}
+
+	free(frame.buf);
+
+	return 0;
+}
+
+
+int main(int argc, const char *argv[])
+{
+	int	r;
+
+	til_init();
+
+	r = check();
+	if (!r)
+		r = bench();
+
+	til_shutdown();
+
+	if (r < 0) {
+		fprintf(stderr, "convert_test: %s\n", strerror(-r));
+		return EXIT_FAILURE;
+	}
+
+	return r ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -14,30 +14,352 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <gtk/gtk.h>
 #include <inttypes.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <til_fb.h>
 #include <til_settings.h>
 
-/* glimmer's GTK+-3.0 backend fb for rototiller */
+#include "gtk_fb.h"
+
+#define GTK_FB_ARENA_ALIGN	(2 * 1024 * 1024)	/* x86-64 huge page size */
+#define GTK_FB_ARENA_SLOTS	(GTK_FB_NUM_PAGES + 1)	/* pages carved per arena, + the one GtkImage may still hold */
+#define GTK_FB_ALIGN(_v, _a)	((((_v) + (_a) - 1) / (_a)) * (_a))
+#define GTK_FB_DAMAGE_TILE	64			/* width and height of damage tiles in pixels */
+
+typedef struct gtk_fb_arena_t gtk_fb_arena_t;
+
+/* With hugepages=on all pages of a given size are carved from a single
+ * mapping backed by huge pages, either explicitly via MAP_HUGETLB when
+ * reserved, or 2MB-aligned and advised for THP otherwise.
+ *
+ * Surfaces wrapping arena memory may outlive their pages, since GtkImage
+ * holds its own reference on whatever surface was last presented.  So
+ * slots are released by the surface's destroy notify, and an arena
+ * retired by a resize is only unmapped once its last surface is gone.
+ */
+struct gtk_fb_arena_t {
+	void		*base;
+	size_t		size, slot_size;
+	unsigned	width, height;
+	int		stride;
+	unsigned	used;		/* bitmap of slots in use */
+	unsigned	hugetlb:1;
+	unsigned	retired:1;
+};
+
+typedef struct gtk_fb_arena_slot_t {
+	gtk_fb_arena_t	*arena;
+	unsigned	slot;
+} gtk_fb_arena_slot_t;
 
 typedef struct gtk_fb_t {
 	GtkWidget	*window;
 	GtkWidget	*image;
+	cairo_surface_t	*front;		/* persistently presented surface with damage=on */
 	unsigned	width, height;
+	gtk_fb_arena_t	*arena;
+	size_t		page_bytes;	/* bytes of live pages for stats */
+	int		*perf_fds;	/* per-thread dTLB miss counters for stats */
+	unsigned	n_perf_fds;
+	gtk_fb_timings_t	timings;
+	uint64_t	present_ns;	/* when the pending present's "draw" began, 0 if none */
+	GdkFrameClock	*frame_clock;
+	gulong		after_paint_id;
 	unsigned	fullscreen:1;
 	unsigned	resized:1;
+	unsigned	hugepages:1;
+	unsigned	stats:1;
+	unsigned	damage:1;
 } gtk_fb_t;
 
 typedef struct gtk_fb_page_t gtk_fb_page_t;
 
 struct gtk_fb_page_t {
 	cairo_surface_t	*surface;
+	size_t		bytes;
 };
 
+static cairo_user_data_key_t	gtk_fb_arena_slot_key;
+
+_Static_assert(GTK_FB_ARENA_SLOTS <= sizeof(((gtk_fb_arena_t *)0)->used) * 8, "arena slots exceed the used bitmap");
+
+
+static gtk_fb_arena_t * gtk_fb_arena_new(unsigned width, unsigned height)
+{
+	gtk_fb_arena_t	*a;
+	void		*base;
+
+	a = calloc(1, sizeof(gtk_fb_arena_t));
+	if (!a)
+		return NULL;
+
+	a->width = width;
+	a->height = height;
+	a->stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width);
+	a->slot_size = GTK_FB_ALIGN((size_t)a->stride * height, 64);
+	a->size = GTK_FB_ALIGN(a->slot_size * GTK_FB_ARENA_SLOTS, GTK_FB_ARENA_ALIGN);
+
+	base = mmap(NULL, a->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (base != MAP_FAILED) {
+		a->base = base;
+		a->hugetlb = 1;
+
+		return a;
+	}
+
+	/* no reserved huge pages, overallocate to get a 2MB-aligned range for THP */
+	base = mmap(NULL, a->size + GTK_FB_ARENA_ALIGN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		free(a);
+
+		return NULL;
+	}
+
+	a->base = (void *)GTK_FB_ALIGN((uintptr_t)base, GTK_FB_ARENA_ALIGN);
+	if (a->base != base)
+		munmap(base, (uintptr_t)a->base - (uintptr_t)base);
+	munmap((char *)a->base + a->size, GTK_FB_ARENA_ALIGN - ((uintptr_t)a->base - (uintptr_t)base));
+	madvise(a->base, a->size, MADV_HUGEPAGE);
+
+	return a;
+}
+
+
+static void gtk_fb_arena_free(gtk_fb_arena_t *a)
+{
+	munmap(a->base, a->size);
+	free(a);
+}
+
+
+/* retire the arena, it's freed immediately if unused, otherwise when its last slot is released */
+static void gtk_fb_arena_retire(gtk_fb_arena_t *a)
+{
+	if (!a->used) {
+		gtk_fb_arena_free(a);
+		return;
+	}
+
+	a->retired = 1;
+}
+
+
+static void gtk_fb_arena_slot_destroy(void *data)
+{
+	gtk_fb_arena_slot_t	*s = data;
+	gtk_fb_arena_t		*a = s->arena;
+
+	a->used &= ~(1u << s->slot);
+	if (a->retired && !a->used)
+		gtk_fb_arena_free(a);
+
+	free(s);
+}
+
+
+/* returns a surface carved from c's arena, or NULL if one couldn't be had */
+static cairo_surface_t * gtk_fb_arena_surface(gtk_fb_t *c)
+{
+	gtk_fb_arena_slot_t	*s;
+	cairo_surface_t		*surface;
+	unsigned		slot;
+
+	if (c->arena && (c->arena->width != c->width || c->arena->height != c->height)) {
+		gtk_fb_arena_retire(c->arena);
+		c->arena = NULL;
+	}
+
+	if (!c->arena) {
+		c->arena = gtk_fb_arena_new(c->width, c->height);
+		if (!c->arena)
+			return NULL;
+	}
+
+	for (slot = 0; slot < GTK_FB_ARENA_SLOTS; slot++) {
+		if (!(c->arena->used & (1u << slot)))
+			break;
+	}
+
+	/* With damage=off GtkImage keeps the last flipped page's surface
+	 * across til_fb_rebuild(), which is why there's a spare slot.  Should
+	 * that still not suffice, e.g. resizing A->B->A between flips leaves
+	 * another slot of this arena held, the caller falls back to a regular
+	 * surface for the excess.
+	 */
+	if (slot == GTK_FB_ARENA_SLOTS)
+		return NULL;
+
+	s = calloc(1, sizeof(gtk_fb_arena_slot_t));
+	if (!s)
+		return NULL;
+
+	s->arena = c->arena;
+	s->slot = slot;
+
+	surface = cairo_image_surface_create_for_data((unsigned char *)c->arena->base + slot * c->arena->slot_size,
+							CAIRO_FORMAT_RGB24,
+							c->width,
+							c->height,
+							c->arena->stride);
+	if (cairo_surface_set_user_data(surface, &gtk_fb_arena_slot_key, s, gtk_fb_arena_slot_destroy) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+		free(s);
+
+		return NULL;
+	}
+
+	c->arena->used |= (1u << slot);
+
+	return surface;
+}
+
+
+/* open dTLB read miss counters on every thread currently in the process,
+ * inheriting into threads created later like glimmer's render thread.
+ * This is best-effort, perf may well be unavailable or forbidden.
+ */
+static void gtk_fb_perf_open(gtk_fb_t *c)
+{
+	struct perf_event_attr	attr = {
+					.type = PERF_TYPE_HW_CACHE,
+					.size = sizeof(attr),
+					.config = PERF_COUNT_HW_CACHE_DTLB |
+						  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+						  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+					.exclude_kernel = 1,
+					.exclude_hv = 1,
+					.inherit = 1,
+				};
+	struct dirent		*dent;
+	DIR			*dir;
+
+	dir = opendir("/proc/self/task");
+	if (!dir)
+		return;
+
+	while ((dent = readdir(dir))) {
+		int	*fds, fd;
+		pid_t	tid;
+
+		tid = atoi(dent->d_name);
+		if (tid <= 0)
+			continue;
+
+		fd = syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+		if (fd < 0)
+			continue;
+
+		fds = realloc(c->perf_fds, (c->n_perf_fds + 1) * sizeof(int));
+		if (!fds) {
+			close(fd);
+			break;
+		}
+
+		fds[c->n_perf_fds++] = fd;
+		c->perf_fds = fds;
+	}
+
+	closedir(dir);
+}
+
+
+static void gtk_fb_perf_close(gtk_fb_t *c)
+{
+	for (unsigned i = 0; i < c->n_perf_fds; i++)
+		close(c->perf_fds[i]);
+
+	free(c->perf_fds);
+	c->perf_fds = NULL;
+	c->n_perf_fds = 0;
+}
+
+
+static uint64_t gtk_fb_now_ns(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void gtk_fb_timing_add(gtk_fb_timing_t *t, uint64_t start_ns)
+{
+	uint64_t	ns = gtk_fb_now_ns() - start_ns;
+
+	t->n++;
+	t->total_ns += ns;
+	if (ns > t->max_ns)
+		t->max_ns = ns;
+}
+
+
+static void gtk_fb_timing_print(const char *name, const gtk_fb_timing_t *t)
+{
+	fprintf(stderr, ", %s: %" PRIu64 " avg %" PRIu64 "us max %" PRIu64 "us",
+		name, t->n,
+		t->n ? t->total_ns / t->n / 1000 : 0,
+		t->max_ns / 1000);
+}
+
+
+/* print memory, dTLB miss, and presentation timing accounting for this output to stderr */
+static void gtk_fb_stats(gtk_fb_t *c)
+{
+	uint64_t	misses = 0;
+
+	fprintf(stderr, "gtk_fb: %ux%u pages: %zu KiB", c->width, c->height, c->page_bytes / 1024);
+
+	if (c->arena) {
+		long		pagesize = sysconf(_SC_PAGESIZE);
+		size_t		n = (c->arena->size + pagesize - 1) / pagesize, resident = 0;
+		unsigned char	*vec;
+
+		vec = malloc(n);
+		if (vec && !mincore(c->arena->base, c->arena->size, vec)) {
+			for (size_t i = 0; i < n; i++)
+				resident += (vec[i] & 1);
+		}
+		free(vec);
+
+		fprintf(stderr, ", arena: %zu KiB %s, %zu KiB resident",
+			c->arena->size / 1024,
+			c->arena->hugetlb ? "hugetlb" : "thp-advised",
+			resident * pagesize / 1024);
+	}
+
+	if (c->n_perf_fds) {
+		for (unsigned i = 0; i < c->n_perf_fds; i++) {
+			uint64_t	count;
+
+			if (read(c->perf_fds[i], &count, sizeof(count)) == sizeof(count))
+				misses += count;
+		}
+
+		fprintf(stderr, ", dTLB read misses: %" PRIu64, misses);
+	}
+
+	fputc('\n', stderr);
+
+	fprintf(stderr, "gtk_fb: %ux%u", c->width, c->height);
+	gtk_fb_timing_print("flips", &c->timings.flips);
+	gtk_fb_timing_print("presents", &c->timings.presents);
+	gtk_fb_timing_print("rebuilds", &c->timings.rebuilds);
+	gtk_fb_timing_print("page allocs", &c->timings.page_allocs);
+	fputc('\n', stderr);
+}
+
 
 /* called on "size-allocate" for the fb's gtk image */
 static void resized(GtkWidget *widget, GtkAllocation *allocation, gpointer user_data)
@@ -79,6 +401,9 @@ static int gtk_fb_init(const til_settings_t *settings, void **res_context)
 {
 	const char	*fullscreen;
 	const char	*size;
+	const char	*hugepages;
+	const char	*stats;
+	const char	*damage;
 	gtk_fb_t	*c;
 	int		r;
 
@@ -103,6 +428,20 @@ static int gtk_fb_init(const til_settings_t *settings, void **res_context)
 	if (size) /* TODO: errors */
 		sscanf(size, "%u%*[xX]%u", &c->width, &c->height);
 
+	hugepages = til_settings_get_value(settings, "hugepages", NULL);
+	if (hugepages && !strcasecmp(hugepages, "on"))
+		c->hugepages = 1;
+
+	stats = til_settings_get_value(settings, "stats", NULL);
+	if (stats && !strcasecmp(stats, "on")) {
+		c->stats = 1;
+		gtk_fb_perf_open(c);
+	}
+
+	damage = til_settings_get_value(settings, "damage", NULL);
+	if (damage && !strcasecmp(damage, "on"))
+		c->damage = 1;
+
 	c->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 	gtk_widget_realize(c->window);
 	g_signal_connect(c->window, "delete-event", G_CALLBACK(deleted), c);
@@ -117,6 +456,14 @@ static void gtk_fb_shutdown(til_fb_t *fb, void *context)
 {
 	gtk_fb_t	*c = context;
 
+	if (c->stats) {
+		gtk_fb_stats(c);
+		gtk_fb_perf_close(c);
+	}
+
+	if (c->arena)
+		gtk_fb_arena_retire(c->arena);
+
 	if (c->window)
 		gtk_widget_destroy(c->window);
 	free(c);
@@ -149,6 +496,46 @@ static gboolean queue_draw_cb(GtkWidget *widget, GdkFrameClock *frame_clock, gpo
 	return G_SOURCE_CONTINUE;
 }
 
+/* With stats=on presents are timed from "draw" on the image, ahead of the
+ * GtkImage class handler painting the presented surface into the window
+ * (the actual upload, via XSHM when available), until the frame clock's
+ * "after-paint", when gdk is done flushing the frame to the window.
+ */
+static gboolean present_begin_cb(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+	gtk_fb_t	*c = user_data;
+
+	if (!c->present_ns)
+		c->present_ns = gtk_fb_now_ns();
+
+	return FALSE;
+}
+
+
+static void present_end_cb(GdkFrameClock *frame_clock, gpointer user_data)
+{
+	gtk_fb_t	*c = user_data;
+
+	if (!c->present_ns)
+		return;
+
+	gtk_fb_timing_add(&c->timings.presents, c->present_ns);
+	c->present_ns = 0;
+}
+
+/* With damage=on the "tick" flips directly, and the flip queues drawing of
+ * only the damaged areas.  Driving the flip from "draw" would require queueing
+ * the whole image every tick, defeating the point.
+ */
+static gboolean flip_cb(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+	til_fb_t	*fb = user_data;
+
+	til_fb_flip(fb);
+
+	return G_SOURCE_CONTINUE;
+}
+
 
 static int gtk_fb_acquire(til_fb_t *fb, void *context, void *page)
 {
@@ -158,14 +545,28 @@ static int gtk_fb_acquire(til_fb_t *fb, void *context, void *page)
 	if (!c->window)
 		return -EPIPE;
 
-	c->image = gtk_image_new_from_surface(p->surface);
+	if (c->damage) {
+		c->image = gtk_image_new_from_surface(NULL);
+		gtk_widget_add_tick_callback(c->image, flip_cb, fb, NULL);
+	} else {
+		c->image = gtk_image_new_from_surface(p->surface);
+		g_signal_connect(c->image, "draw", G_CALLBACK(draw_cb), fb);
+		gtk_widget_add_tick_callback(c->image, queue_draw_cb, c, NULL);
+	}
+	/* connected after draw_cb(), so the flip isn't counted as part of the present */
+	if (c->stats)
+		g_signal_connect(c->image, "draw", G_CALLBACK(present_begin_cb), c);
 	g_signal_connect_after(c->image, "size-allocate", G_CALLBACK(resized), c);
-	g_signal_connect(c->image, "draw", G_CALLBACK(draw_cb), fb);
 	gtk_widget_set_size_request(c->image, c->width, c->height);
-	gtk_widget_add_tick_callback(c->image, queue_draw_cb, c, NULL);
 	gtk_container_add(GTK_CONTAINER(c->window), c->image);
 	gtk_widget_show_all(c->window);
 
+	if (c->stats) {
+		c->frame_clock = gtk_widget_get_frame_clock(c->window);
+		if (c->frame_clock)
+			c->after_paint_id = g_signal_connect(c->frame_clock, "after-paint", G_CALLBACK(present_end_cb), c);
+	}
+
 	return 0;
 }
 
@@ -174,8 +575,19 @@ static void gtk_fb_release(til_fb_t *fb, void *context)
 {
 	gtk_fb_t	*c = context;
 
+	if (c->window && c->after_paint_id)
+		g_signal_handler_disconnect(c->frame_clock, c->after_paint_id);
+	c->frame_clock = NULL;
+	c->after_paint_id = 0;
+	c->present_ns = 0;
+
 	if (c->window)
 		gtk_widget_destroy(c->image);
+
+	if (c->front) {
+		cairo_surface_destroy(c->front);
+		c->front = NULL;
+	}
 }
 
 
@@ -184,19 +596,36 @@ static void * gtk_fb_page_alloc(til_fb_t *fb, void *context, til_fb_page_t *res_
 	gtk_fb_t	*c = context;
 	gtk_fb_page_t	*p;
 	GdkWindow	*gdk_window;
+	uint64_t	start_ns = 0;
 
 	if (!c->window)
 		return NULL;
 
+	if (c->stats)
+		start_ns = gtk_fb_now_ns();
+
 	p = calloc(1, sizeof(gtk_fb_page_t));
 	if (!p)
 		return NULL;
 
+	/* Note arena surfaces are plain cairo image surfaces, forgoing the XSHM
+	 * upload gdk_window_create_similar_image_surface() may enable below.
+	 * So hugepages=on trades render-side TLB pressure for a potentially
+	 * costlier present, compare both with stats=on before enabling it.
+	 */
+	if (c->hugepages)
+		p->surface = gtk_fb_arena_surface(c);
+
 	/* by using gdk_window_create_similar_image_surface(), we enable
 	 * potential optimizations like XSHM use on the xlib cairo backend.
 	 */
-	gdk_window = gtk_widget_get_window(c->window);
-	p->surface = gdk_window_create_similar_image_surface(gdk_window, CAIRO_FORMAT_RGB24, c->width, c->height, 1);
+	if (!p->surface) {
+		gdk_window = gtk_widget_get_window(c->window);
+		p->surface = gdk_window_create_similar_image_surface(gdk_window, CAIRO_FORMAT_RGB24, c->width, c->height, 1);
+	}
+
+	p->bytes = (size_t)cairo_image_surface_get_stride(p->surface) * c->height;
+	c->page_bytes += p->bytes;
 
 	res_page->fragment.buf = (uint32_t *)cairo_image_surface_get_data(p->surface);
 	res_page->fragment.width = c->width;
@@ -209,6 +638,9 @@ static void * gtk_fb_page_alloc(til_fb_t *fb, void *context, til_fb_page_t *res_
 	cairo_surface_flush(p->surface);
 	cairo_surface_mark_dirty(p->surface);
 
+	if (c->stats)
+		gtk_fb_timing_add(&c->timings.page_allocs, start_ns);
+
 	return p;
 }
 
@@ -218,6 +650,7 @@ static int gtk_fb_page_free(til_fb_t *fb, void *context, void *page)
 	gtk_fb_t	*c = context;
 	gtk_fb_page_t	*p = page;
 
+	c->page_bytes -= p->bytes;
 	cairo_surface_destroy(p->surface);
 	free(p);
 
@@ -225,6 +658,96 @@ static int gtk_fb_page_free(til_fb_t *fb, void *context, void *page)
 }
 
 
+/* (re)create the front surface to match page, presenting page in full */
+static void gtk_fb_front_rebuild(gtk_fb_t *c, gtk_fb_page_t *p)
+{
+	int		width = cairo_image_surface_get_width(p->surface);
+	int		height = cairo_image_surface_get_height(p->surface);
+	int		src_stride = cairo_image_surface_get_stride(p->surface);
+	unsigned char	*src = cairo_image_surface_get_data(p->surface);
+	unsigned char	*dst;
+	int		dst_stride;
+
+	if (c->front)
+		cairo_surface_destroy(c->front);
+
+	c->front = gdk_window_create_similar_image_surface(gtk_widget_get_window(c->window), CAIRO_FORMAT_RGB24, width, height, 1);
+	cairo_surface_flush(c->front);
+	dst = cairo_image_surface_get_data(c->front);
+	dst_stride = cairo_image_surface_get_stride(c->front);
+
+	for (int y = 0; y < height; y++)
+		memcpy(dst + y * dst_stride, src + y * src_stride, width * 4);
+
+	cairo_surface_mark_dirty(c->front);
+	gtk_image_set_from_surface(GTK_IMAGE(c->image), c->front);
+}
+
+
+/* Compare page against the front surface tile by tile, copying only the
+ * changed tiles into front and invalidating their areas.  Changed tiles are
+ * coalesced into horizontal runs per row of tiles to keep the number of
+ * invalidated rectangles down.  memcmp() is already vectorized by libc and
+ * bails on the first difference, which is the common case for changed tiles.
+ */
+static void gtk_fb_front_damage(gtk_fb_t *c, gtk_fb_page_t *p)
+{
+	int		width = cairo_image_surface_get_width(p->surface);
+	int		height = cairo_image_surface_get_height(p->surface);
+	int		src_stride = cairo_image_surface_get_stride(p->surface);
+	int		dst_stride = cairo_image_surface_get_stride(c->front);
+	unsigned char	*src = cairo_image_surface_get_data(p->surface);
+	unsigned char	*dst = cairo_image_surface_get_data(c->front);
+	GtkAllocation	alloc;
+	int		xoff, yoff;
+
+	/* GtkImage centers the surface within its allocation */
+	gtk_widget_get_allocation(c->image, &alloc);
+	xoff = (alloc.width - width) / 2;
+	yoff = (alloc.height - height) / 2;
+
+	cairo_surface_flush(c->front);
+
+	for (int ty = 0; ty < height; ty += GTK_FB_DAMAGE_TILE) {
+		int	th = MIN(GTK_FB_DAMAGE_TILE, height - ty);
+		int	run_x = -1;
+
+		for (int tx = 0; tx < width; tx += GTK_FB_DAMAGE_TILE) {
+			int	tw = MIN(GTK_FB_DAMAGE_TILE, width - tx);
+			int	changed = 0;
+
+			for (int y = ty; y < ty + th; y++) {
+				if (memcmp(src + y * src_stride + tx * 4, dst + y * dst_stride + tx * 4, tw * 4)) {
+					changed = 1;
+					break;
+				}
+			}
+
+			if (changed) {
+				for (int y = ty; y < ty + th; y++)
+					memcpy(dst + y * dst_stride + tx * 4, src + y * src_stride + tx * 4, tw * 4);
+
+				if (run_x < 0)
+					run_x = tx;
+
+				continue;
+			}
+
+			if (run_x >= 0) {
+				cairo_surface_mark_dirty_rectangle(c->front, run_x, ty, tx - run_x, th);
+				gtk_widget_queue_draw_area(c->image, xoff + run_x, yoff + ty, tx - run_x, th);
+				run_x = -1;
+			}
+		}
+
+		if (run_x >= 0) {
+			cairo_surface_mark_dirty_rectangle(c->front, run_x, ty, width - run_x, th);
+			gtk_widget_queue_draw_area(c->image, xoff + run_x, yoff + ty, width - run_x, th);
+		}
+	}
+}
+
+
 /* XXX: due to gtk's event-driven nature, this isn't a vsync-synchronous page flip,
  * so til_fb_flip() must be scheduled independently to not just spin.
  * The "draw" signal on the image is used to drive til_fb_flip() on frameclock "ticks",
@@ -234,22 +757,56 @@ static int gtk_fb_page_flip(til_fb_t *fb, void *context, void *page)
 {
 	gtk_fb_t	*c = context;
 	gtk_fb_page_t	*p = page;
+	uint64_t	start_ns = 0;
 
 	if (!c->window)
 		return -EPIPE;
 
-	cairo_surface_mark_dirty(p->surface);
-	gtk_image_set_from_surface(GTK_IMAGE(c->image), p->surface);
+	if (c->stats)
+		start_ns = gtk_fb_now_ns();
+
+	if (c->damage) {
+		if (!c->front ||
+		    cairo_image_surface_get_width(c->front) != cairo_image_surface_get_width(p->surface) ||
+		    cairo_image_surface_get_height(c->front) != cairo_image_surface_get_height(p->surface))
+			gtk_fb_front_rebuild(c, p);
+		else
+			gtk_fb_front_damage(c, p);
+	} else {
+		cairo_surface_mark_dirty(p->surface);
+		gtk_image_set_from_surface(GTK_IMAGE(c->image), p->surface);
+	}
+
+	if (c->stats)
+		gtk_fb_timing_add(&c->timings.flips, start_ns);
 
 	if (c->resized) {
 		c->resized = 0;
+		if (c->stats)
+			start_ns = gtk_fb_now_ns();
 		til_fb_rebuild(fb);
+		if (c->stats) {
+			gtk_fb_timing_add(&c->timings.rebuilds, start_ns);
+			gtk_fb_stats(c);
+		}
 	}
 
 	return 0;
 }
 
 
+/* get the presentation path timings of a gtk_fb context, only recorded with stats=on */
+void gtk_fb_timings(void *context, gtk_fb_timings_t *res_timings)
+{
+	gtk_fb_t	*c = context;
+
+	assert(c);
+	assert(res_timings);
+
+	*res_timings = c->timings;
+}
+
+
 til_fb_ops_t gtk_fb_ops = {
 	/* TODO: .setup may not be necessary in the gtk frontend, unless maybe
 	 * it learns to use multiple fb backends, and would like to do the whole dynamic
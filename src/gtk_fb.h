@@ -0,0 +1,30 @@
+#ifndef _GTK_FB_H
+#define _GTK_FB_H
+
+#include <stdint.h>
+
+#include <til_fb.h>
+
+/* glimmer's GTK+-3.0 backend fb for rototiller */
+
+#define GTK_FB_NUM_PAGES	3	/* pages to til_fb_new(), gtk_fb sizes its hugepages arena from it */
+
+/* presentation path costs for stats, so regressions in gtk_fb itself are
+ * visible separately from module render costs.
+ */
+typedef struct gtk_fb_timing_t {
+	uint64_t	n, total_ns, max_ns;
+} gtk_fb_timing_t;
+
+typedef struct gtk_fb_timings_t {
+	gtk_fb_timing_t	flips;		/* handing a page to the image, or diffing it into the front with damage=on */
+	gtk_fb_timing_t	presents;	/* drawing the image into the window through the end of the frame */
+	gtk_fb_timing_t	rebuilds;	/* til_fb_rebuild() on resizes */
+	gtk_fb_timing_t	page_allocs;
+} gtk_fb_timings_t;
+
+extern til_fb_ops_t gtk_fb_ops;
+
+void gtk_fb_timings(void *context, gtk_fb_timings_t *res_timings);
+
+#endif
@@ -14,16 +14,21 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <gtk/gtk.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <til.h>
 #include <til_args.h>
 
-/* glimmer is a GTK+-3.0 frontend for rototiller */
+#include "gtk_fb.h"
+#include "module_setup.h"
+#include "playlist.h"
+#include "scale.h"
 
-extern til_fb_ops_t gtk_fb_ops;
+/* glimmer is a GTK+-3.0 frontend for rototiller */
 
 #define DEFAULT_WIDTH	320
 #define DEFAULT_HEIGHT	480
@@ -33,22 +38,54 @@ extern til_fb_ops_t gtk_fb_ops;
 #define FRAME_MARGIN	8
 #define LABEL_MARGIN	4
 #define CONTROL_MARGIN	LABEL_MARGIN
-#define NUM_FB_PAGES	3
+
+#define WATCHDOG_RECOVERIES	120	/* consecutive fitting frames before raising scale or starting remedies over */
+#define WATCHDOG_MAX_REMEDIES	8
+
+typedef enum glimmer_remedy_t {
+	GLIMMER_REMEDY_SCALE,		/* halve the render resolution, until max_scale */
+	GLIMMER_REMEDY_RESTART,		/* recreate the module context */
+	GLIMMER_REMEDY_FALLBACK,	/* switch to the fallback module */
+} glimmer_remedy_t;
 
 static struct glimmer_t {
 	GtkComboBox		*modules_combobox;
 	GtkWidget		*window, *module_box, *module_frame, *settings_box, *settings_frame;
 
 	til_args_t		args;
+	const char		*playlist_path;
+	const char		*watchdog_args;
 	til_settings_t		*video_settings;
 	til_settings_t		*module_settings;
 
 	til_fb_t		*fb;
 	const til_module_t	*module;
 	void			*module_context;
+	void			*module_setup;
+	playlist_t		*playlist;	/* when set, renders in place of module */
 	pthread_t		thread;
 	struct timeval		start_tv;
 	unsigned		ticks_offset;	/* XXX: this isn't leveraged currently */
+
+	/* The watchdog warns when the module misses the frame budget max_misses
+	 * times in a row, and escalates through the remedies of its policy in
+	 * order.  The policy is empty unless opted into via --watchdog, so by
+	 * default it only warns.  It all happens on the render thread, the gtk
+	 * main loop is never blocked on a slow module.
+	 */
+	struct {
+		unsigned		budget_us, max_misses, max_scale;
+		glimmer_remedy_t	policy[WATCHDOG_MAX_REMEDIES];
+		unsigned		n_policy;
+		const til_module_t	*fallback;
+		til_settings_t		*fallback_settings;
+		void			*fallback_setup;
+
+		unsigned		misses, recoveries;
+		unsigned		calm;		/* consecutive frames within budget, saturating at WATCHDOG_RECOVERIES */
+		unsigned		remedy;		/* index into policy of the next remedy to try */
+		scale_t			scale;
+	} watchdog;
 } glimmer;
 
 
@@ -102,6 +139,246 @@ static void glimmer_active_settings_rebuild(void)
 }
 
 
+/* replace the running module context with a new one, from the render thread */
+static int glimmer_context_replace(const til_module_t *module, void *setup, unsigned ticks)
+{
+	void	*context;
+	int	r, oldstate;
+
+	/* glimmer_go() cancels this thread, don't let that strand a half-replaced context */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+	r = til_module_create_context(module, ticks, setup, &context);
+	if (r >= 0) {
+		til_module_destroy_context(glimmer.module, glimmer.module_context);
+		glimmer.module = module;
+		glimmer.module_context = context;
+		glimmer.module_setup = setup;
+	}
+	pthread_setcancelstate(oldstate, NULL);
+
+	return r;
+}
+
+
+static void glimmer_render_unscaled(unsigned ticks, til_fb_fragment_t *fragment)
+{
+	int	oldstate;
+
+	if (!glimmer.playlist) {
+		til_module_render(glimmer.module, glimmer.module_context, ticks, fragment);
+		return;
+	}
+
+	/* the playlist swaps contexts mid-render, don't let glimmer_go() cancel that */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+	/* the transitions' scale stacks on the watchdog's, keep the total within max_scale */
+	playlist_render(glimmer.playlist, ticks, fragment,
+			glimmer.watchdog.max_scale / (glimmer.watchdog.scale.scale > 1 ? glimmer.watchdog.scale.scale : 1));
+	pthread_setcancelstate(oldstate, NULL);
+}
+
+
+/* render at the watchdog's scale, upscaling into fragment when lowered */
+static void glimmer_render(unsigned ticks, til_fb_fragment_t *fragment)
+{
+	til_fb_fragment_t	*scaled;
+
+	scaled = scale_fragment(&glimmer.watchdog.scale, fragment);
+	if (!scaled) { /* just render at full scale */
+		glimmer_render_unscaled(ticks, fragment);
+		return;
+	}
+
+	glimmer_render_unscaled(ticks, scaled);
+	if (scaled != fragment)
+		scale_upscale(&glimmer.watchdog.scale, fragment);
+}
+
+
+/* track the render time of a frame against the budget, escalating remedies on repeated misses */
+static void glimmer_watchdog(unsigned ticks, unsigned elapsed_us)
+{
+	const char	*name = glimmer.playlist ? "playlist" : glimmer.module->name;
+	scale_t		*scale = &glimmer.watchdog.scale;
+
+	if (elapsed_us <= glimmer.watchdog.budget_us) {
+		glimmer.watchdog.misses = 0;
+
+		/* a lasting recovery starts escalation over, whatever the policy */
+		if (glimmer.watchdog.calm < WATCHDOG_RECOVERIES &&
+		    ++glimmer.watchdog.calm == WATCHDOG_RECOVERIES)
+			glimmer.watchdog.remedy = 0;
+
+		/* halving the divisor quadruples the pixels, so only raise the
+		 * scale when the frame would still fit in the budget at 4x its cost.
+		 */
+		if (scale->scale <= 1 || elapsed_us * 4 > glimmer.watchdog.budget_us) {
+			glimmer.watchdog.recoveries = 0;
+			return;
+		}
+
+		if (++glimmer.watchdog.recoveries < WATCHDOG_RECOVERIES)
+			return;
+
+		glimmer.watchdog.recoveries = 0;
+		scale->scale /= 2;
+		fprintf(stderr, "watchdog: %s recovered, raising render scale to 1/%u\n", name, scale->scale);
+
+		return;
+	}
+
+	glimmer.watchdog.calm = glimmer.watchdog.recoveries = 0;
+	if (++glimmer.watchdog.misses < glimmer.watchdog.max_misses)
+		return;
+
+	glimmer.watchdog.misses = 0;
+	fprintf(stderr, "watchdog: %s missed %u consecutive frame budgets of %uus, last frame took %uus\n",
+		name, glimmer.watchdog.max_misses, glimmer.watchdog.budget_us, elapsed_us);
+
+	while (glimmer.watchdog.remedy < glimmer.watchdog.n_policy) {
+		switch (glimmer.watchdog.policy[glimmer.watchdog.remedy]) {
+		case GLIMMER_REMEDY_SCALE:
+			if (scale->scale * 2 > glimmer.watchdog.max_scale)
+				break;
+
+			scale->scale = scale->scale > 1 ? scale->scale * 2 : 2;
+			fprintf(stderr, "watchdog: lowering render scale to 1/%u\n", scale->scale);
+
+			return;
+
+		case GLIMMER_REMEDY_RESTART:
+			/* the playlist owns its contexts, and already moves on by itself */
+			if (glimmer.playlist)
+				break;
+
+			glimmer.watchdog.remedy++;
+			fprintf(stderr, "watchdog: restarting %s context\n", name);
+			if (glimmer_context_replace(glimmer.module, glimmer.module_setup, ticks) < 0)
+				fprintf(stderr, "watchdog: unable to restart %s context\n", name);
+
+			return;
+
+		case GLIMMER_REMEDY_FALLBACK:
+			if (glimmer.playlist || glimmer.module == glimmer.watchdog.fallback)
+				break;
+
+			fprintf(stderr, "watchdog: falling back to %s\n", glimmer.watchdog.fallback->name);
+			if (glimmer_context_replace(glimmer.watchdog.fallback, glimmer.watchdog.fallback_setup, ticks) < 0) {
+				fprintf(stderr, "watchdog: unable to create %s context\n", glimmer.watchdog.fallback->name);
+				glimmer.watchdog.remedy++;
+
+				return;
+			}
+
+			/* the fallback gets the whole policy applied anew */
+			glimmer.watchdog.remedy = 0;
+
+			return;
+		}
+
+		glimmer.watchdog.remedy++;
+	}
+}
+
+
+/* apply the watchdog settings, returns -errno on invalid settings */
+static int glimmer_watchdog_configure(til_settings_t *settings)
+{
+	char	*policy, *remedy, *saveptr;
+
+	glimmer.watchdog.budget_us = strtoul(til_settings_get_value(settings, "budget", NULL), NULL, 10) * 1000;
+	glimmer.watchdog.max_misses = strtoul(til_settings_get_value(settings, "misses", NULL), NULL, 10);
+	glimmer.watchdog.max_scale = strtoul(til_settings_get_value(settings, "max_scale", NULL), NULL, 10);
+	if (!glimmer.watchdog.budget_us || !glimmer.watchdog.max_misses || !glimmer.watchdog.max_scale) {
+		fprintf(stderr, "watchdog: budget, misses, and max_scale must be positive integers\n");
+		return -EINVAL;
+	}
+
+	policy = strdup(til_settings_get_value(settings, "policy", NULL));
+	if (!policy)
+		return -ENOMEM;
+
+	for (remedy = strtok_r(policy, "+", &saveptr); remedy; remedy = strtok_r(NULL, "+", &saveptr)) {
+		glimmer_remedy_t	r;
+
+		if (!strcasecmp(remedy, "none"))
+			continue;
+		else if (!strcasecmp(remedy, "scale"))
+			r = GLIMMER_REMEDY_SCALE;
+		else if (!strcasecmp(remedy, "restart"))
+			r = GLIMMER_REMEDY_RESTART;
+		else if (!strcasecmp(remedy, "fallback"))
+			r = GLIMMER_REMEDY_FALLBACK;
+		else {
+			fprintf(stderr, "watchdog: unknown remedy \"%s\"\n", remedy);
+			free(policy);
+
+			return -EINVAL;
+		}
+
+		if (glimmer.watchdog.n_policy == WATCHDOG_MAX_REMEDIES) {
+			fprintf(stderr, "watchdog: too many remedies\n");
+			free(policy);
+
+			return -EINVAL;
+		}
+
+		glimmer.watchdog.policy[glimmer.watchdog.n_policy++] = r;
+	}
+	free(policy);
+
+	glimmer.watchdog.fallback = til_lookup_module(til_settings_get_value(settings, "fallback", NULL));
+	if (!glimmer.watchdog.fallback) {
+		fprintf(stderr, "watchdog: unknown fallback module \"%s\"\n", til_settings_get_value(settings, "fallback", NULL));
+		return -EINVAL;
+	}
+
+	/* the fallback's setup is made once here, and reused for every fallback */
+	glimmer.watchdog.fallback_settings = til_settings_new(NULL);
+	if (!glimmer.watchdog.fallback_settings)
+		return -ENOMEM;
+
+	if (module_setup_defaults(glimmer.watchdog.fallback, glimmer.watchdog.fallback_settings, &glimmer.watchdog.fallback_setup) < 0) {
+		fprintf(stderr, "watchdog: unable to setup fallback module \"%s\"\n", glimmer.watchdog.fallback->name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+
+/* parse --watchdog settings over the defaults, returns -errno on invalid settings */
+static int glimmer_watchdog_setup(const char *args)
+{
+	static const struct {
+		const char	*key, *value;
+	} defaults[] = {
+		{ "budget", "33" },			/* ms of render time per frame */
+		{ "misses", "10" },			/* consecutive missed budgets before acting */
+		{ "max_scale", "4" },			/* lowest resolution divisor the scale remedy goes to */
+		{ "policy", "none" },			/* remedies in order of escalation, e.g. "scale+restart+fallback" */
+		{ "fallback", "roto" },			/* module of the fallback remedy */
+		{}
+	};
+	til_settings_t	*settings;
+	int		r;
+
+	settings = til_settings_new(args);
+	if (!settings)
+		return -ENOMEM;
+
+	for (int i = 0; defaults[i].key; i++) {
+		if (!til_settings_get_value(settings, defaults[i].key, NULL))
+			til_settings_add_value(settings, defaults[i].key, defaults[i].value, NULL);
+	}
+
+	r = glimmer_watchdog_configure(settings);
+	til_settings_free(settings);
+
+	return r;
+}
+
+
 /* TODO: this should probably move into libtil */
 static void * glimmer_thread(void *foo)
 {
@@ -110,12 +387,17 @@ static void * glimmer_thread(void *foo)
 	for (;;) {
 		til_fb_page_t	*page;
 		unsigned	ticks;
+		struct timespec	before, after;
 
 		page = til_fb_page_get(glimmer.fb);
 		gettimeofday(&now, NULL);
 		ticks = glimmer_get_ticks(&glimmer.start_tv, &now, glimmer.ticks_offset);
-		til_module_render(glimmer.module, glimmer.module_context, ticks, &page->fragment);
+		clock_gettime(CLOCK_MONOTONIC, &before);
+		glimmer_render(ticks, &page->fragment);
+		clock_gettime(CLOCK_MONOTONIC, &after);
 		til_fb_page_put(glimmer.fb, page);
+
+		glimmer_watchdog(ticks, (after.tv_sec - before.tv_sec) * 1000000 + (after.tv_nsec - before.tv_nsec) / 1000);
 	}
 }
 
@@ -132,33 +414,56 @@ static void glimmer_go(GtkButton *button, gpointer user_data)
 		til_quiesce();
 
 		glimmer.fb = til_fb_free(glimmer.fb);
-		glimmer.module_context = til_module_destroy_context(glimmer.module, glimmer.module_context);
+		if (glimmer.playlist)
+			glimmer.playlist = playlist_free(glimmer.playlist);
+		else
+			glimmer.module_context = til_module_destroy_context(glimmer.module, glimmer.module_context);
 	}
 
 	/* TODO: prolly stop recreating fb on every go, or maybe only if the settings changed */
-	r = til_fb_new(&gtk_fb_ops, glimmer.video_settings, NUM_FB_PAGES, &glimmer.fb);
+	r = til_fb_new(&gtk_fb_ops, glimmer.video_settings, GTK_FB_NUM_PAGES, &glimmer.fb);
 	if (r < 0) {
 		puts("fb no go!");
 		return;
 	}
 
 	gettimeofday(&glimmer.start_tv, NULL);
-	glimmer_active_module(&glimmer.module, &settings);
-	if (glimmer.module->setup)
-		glimmer.module->setup(settings, NULL, NULL, &setup);
-	r = til_module_create_context(
-					glimmer.module,
+	if (glimmer.playlist_path) {
+		glimmer.playlist = playlist_new(
+					glimmer.playlist_path,
 					glimmer_get_ticks(
 						&glimmer.start_tv,
 						&glimmer.start_tv,
 						glimmer.ticks_offset),
-					setup,
-					&glimmer.module_context);
-	if (r < 0) {
-		puts("context no go!");
-		return;
+					glimmer.watchdog.budget_us);
+		if (!glimmer.playlist) {
+			puts("playlist no go!");
+			return;
+		}
+	} else {
+		glimmer_active_module(&glimmer.module, &settings);
+		if (glimmer.module->setup)
+			glimmer.module->setup(settings, NULL, NULL, &setup);
+		r = til_module_create_context(
+						glimmer.module,
+						glimmer_get_ticks(
+							&glimmer.start_tv,
+							&glimmer.start_tv,
+							glimmer.ticks_offset),
+						setup,
+						&glimmer.module_context);
+		if (r < 0) {
+			puts("context no go!");
+			return;
+		}
+
+		glimmer.module_setup = setup;
 	}
 
+	glimmer.watchdog.misses = glimmer.watchdog.recoveries = glimmer.watchdog.calm = 0;
+	glimmer.watchdog.scale.scale = 1;
+	glimmer.watchdog.remedy = 0;
+
 	pthread_create(&glimmer.thread, NULL, glimmer_thread, NULL);
 }
 
@@ -460,23 +765,65 @@ static void glimmer_activate(GtkApplication *app, gpointer user_data)
 	g_signal_connect(button, "clicked", G_CALLBACK(glimmer_go), NULL);
 
 	gtk_widget_show_all(glimmer.window);
+
+	/* playlists are for unattended use, so don't wait for Go! */
+	if (glimmer.playlist_path)
+		glimmer_go(NULL, NULL);
 }
 
 
+/* gtk_fb settings used where --video omits them */
+static const struct {
+	const char	*key, *value;
+} video_defaults[] = {
+	{ "fullscreen", "off" },
+	{ "size", "640x480" },
+	{ "hugepages", "off" },
+	{ "stats", "off" },
+	{ "damage", "off" },
+	{}
+};
+
+
 int main(int argc, const char *argv[])
 {
-	int		r, status, pruned_argc;
-	const char	**pruned_argv;
+	int		r, status, pruned_argc, glimmer_argc = 0;
+	const char	**pruned_argv, **glimmer_argv;
 	GtkApplication	*app;
 
 	til_init();
 
-	r = til_args_pruned_parse(argc, argv, &glimmer.args, &pruned_argc, &pruned_argv);
+	/* glimmer's own args are pruned before handing the rest to libtil and gtk */
+	glimmer_argv = calloc(argc + 1, sizeof(*glimmer_argv));
+	if (!glimmer_argv)
+		return EXIT_FAILURE;
+
+	for (int i = 0; i < argc; i++) {
+		if (!strncmp(argv[i], "--playlist=", 11)) {
+			glimmer.playlist_path = argv[i] + 11;
+			continue;
+		}
+
+		if (!strncmp(argv[i], "--watchdog=", 11)) {
+			glimmer.watchdog_args = argv[i] + 11;
+			continue;
+		}
+
+		glimmer_argv[glimmer_argc++] = argv[i];
+	}
+
+	r = til_args_pruned_parse(glimmer_argc, glimmer_argv, &glimmer.args, &pruned_argc, &pruned_argv);
 	if (r < 0) {
 		fprintf(stderr, "Unable to parse args: %s\n", strerror(-r));
 		return EXIT_FAILURE;
 	}
 
+	r = glimmer_watchdog_setup(glimmer.watchdog_args);
+	if (r < 0) {
+		fprintf(stderr, "Unable to setup watchdog: %s\n", strerror(-r));
+		return EXIT_FAILURE;
+	}
+
 	glimmer.module_settings = til_settings_new(glimmer.args.module);
 	/* TODO: glimmer doesn't currently handle video settings, gtk_fb doesn't even
 	 * implement a .setup() method.  It would be an interesting exercise to bring
@@ -488,11 +835,13 @@ int main(int argc, const char *argv[])
 	 * But it'd be nice to at least support window sizing/fullscreen
 	 * startup via args w/gtk_fb, so at some point I should add a
 	 * gtk_fb.setup() method for filling in the blanks of what the args omit.
-	 * For now these statically defined comprehensive settings simply skirt
-	 * the issue.
+	 * For now --video settings are simply completed from static defaults.
 	 */
-	//glimmer.video_settings = til_settings_new(glimmer.args.video);
-	glimmer.video_settings = til_settings_new("fullscreen=off,size=640x480");
+	glimmer.video_settings = til_settings_new(glimmer.args.video);
+	for (int i = 0; video_defaults[i].key; i++) {
+		if (!til_settings_get_value(glimmer.video_settings, video_defaults[i].key, NULL))
+			til_settings_add_value(glimmer.video_settings, video_defaults[i].key, video_defaults[i].value, NULL);
+	}
 
 	app = gtk_application_new("com.pengaru.glimmer", G_APPLICATION_FLAGS_NONE);
 	g_signal_connect(app, "activate", G_CALLBACK(glimmer_activate), NULL);
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <til.h>
+#include <til_settings.h>
+
+#include "module_setup.h"
+
+
+/* fill in any missing settings with their preferred values, for modules
+ * instantiated without going through the settings gui.  Returns -errno
+ * when settings has invalid values for module.
+ */
+int module_setup_defaults(const til_module_t *module, til_settings_t *settings, void **res_setup)
+{
+	til_setting_t			*setting;
+	const til_setting_desc_t	*desc;
+	int				r;
+
+	*res_setup = NULL;
+	if (!module->setup)
+		return 0;
+
+	while ((r = module->setup(settings, &setting, &desc, NULL)) > 0) {
+		if (!setting) {
+			til_settings_add_value(settings, desc->key, desc->preferred, NULL);
+			continue;
+		}
+
+		if (!setting->desc)
+			setting->desc = desc;
+	}
+	if (r < 0)
+		return r;
+
+	return module->setup(settings, NULL, NULL, res_setup);
+}
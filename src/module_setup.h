@@ -0,0 +1,9 @@
+#ifndef _MODULE_SETUP_H
+#define _MODULE_SETUP_H
+
+#include <til.h>
+#include <til_settings.h>
+
+int module_setup_defaults(const til_module_t *module, til_settings_t *settings, void **res_setup);
+
+#endif
@@ -0,0 +1,440 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <errno.h>
+#include <gtk/gtk.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <til.h>
+#include <til_fb.h>
+#include <til_settings.h>
+
+#include "gtk_fb.h"
+
+/* glimmer_perf measures gtk_fb's presentation path in isolation for
+ * `make check-perf`, rendering a synthetic module of constant per-pixel cost
+ * so the numbers only move when gtk_fb or gtk does.  It's meant to run under
+ * Xvfb, comparing against a JSON baseline of the form:
+ *
+ *	{
+ *		"flips_per_sec": { "value": 55, "tolerance": 0.25 },
+ *		"flip_avg_us": { "value": 100, "tolerance": 0.25 },
+ *		...
+ *	}
+ *
+ * Any metric worse than its value by more than its tolerance (as a fraction
+ * of the value) fails the run, as does any metric without samples or
+ * without a value in the baseline.  With --write-baseline the measurements
+ * are written to the baseline instead, keeping its tolerances.
+ */
+
+#define PERF_VIDEO		"fullscreen=off,size=640x480,stats=on"
+#define PERF_WARMUP_MS		1000
+#define PERF_FLIPS_MS		3000
+#define PERF_RESIZES		8
+#define PERF_RESIZE_MS		250
+#define PERF_SETTLE_MS		500
+#define PERF_TOLERANCE		0.25	/* for metrics without a tolerance in the baseline */
+
+typedef enum perf_metric_t {
+	PERF_METRIC_FLIPS_PER_SEC,
+	PERF_METRIC_FLIP_AVG_US,
+	PERF_METRIC_PRESENT_AVG_US,
+	PERF_METRIC_REBUILD_AVG_US,
+	PERF_METRIC_PAGE_ALLOC_AVG_US,
+	PERF_METRIC_CNT
+} perf_metric_t;
+
+static const struct {
+	const char	*name;
+	int		higher_is_better;
+} perf_metrics[PERF_METRIC_CNT] = {
+	[PERF_METRIC_FLIPS_PER_SEC] = { "flips_per_sec", 1 },
+	[PERF_METRIC_FLIP_AVG_US] = { "flip_avg_us", 0 },
+	[PERF_METRIC_PRESENT_AVG_US] = { "present_avg_us", 0 },
+	[PERF_METRIC_REBUILD_AVG_US] = { "rebuild_avg_us", 0 },
+	[PERF_METRIC_PAGE_ALLOC_AVG_US] = { "page_alloc_avg_us", 0 },
+};
+
+static struct perf_t {
+	til_fb_t		*fb;
+	void			*fb_context;
+	pthread_t		thread;
+	GtkWindow		*window;
+	unsigned		resizes;
+	uint64_t		start_ns;
+	gtk_fb_timings_t	start;
+	double			results[PERF_METRIC_CNT];
+	uint64_t		samples[PERF_METRIC_CNT];	/* what each result was derived from */
+	unsigned		frame;
+} perf;
+
+
+static int perf_module_fragmenter(void *context, const til_fb_fragment_t *fragment, unsigned number, til_fb_fragment_t *res_fragment)
+{
+	return til_fb_fragment_tile_single(fragment, 64, number, res_fragment);
+}
+
+
+/* every pixel costs the same each frame, only the color changes */
+static void perf_module_prepare_frame(void *context, unsigned ticks, unsigned n_cpus, til_fb_fragment_t *fragment, til_fragmenter_t *res_fragmenter)
+{
+	*res_fragmenter = perf_module_fragmenter;
+	perf.frame++;
+}
+
+
+static void perf_module_render_fragment(void *context, unsigned ticks, unsigned cpu, til_fb_fragment_t *fragment)
+{
+	uint32_t	color = perf.frame * 0x010203;
+
+	for (unsigned y = 0; y < fragment->height; y++) {
+		uint32_t	*row = (uint32_t *)((uint8_t *)fragment->buf + y * fragment->pitch);
+
+		for (unsigned x = 0; x < fragment->width; x++)
+			row[x] = color ^ (x + y);
+	}
+}
+
+
+static til_module_t	perf_module = {
+	.prepare_frame = perf_module_prepare_frame,
+	.render_fragment = perf_module_render_fragment,
+	.name = "perf",
+	.description = "Constant cost synthetic module",
+};
+
+
+static int perf_fb_init(const til_settings_t *settings, void **res_context)
+{
+	int	r;
+
+	r = gtk_fb_ops.init(settings, res_context);
+	if (r >= 0)
+		perf.fb_context = *res_context;
+
+	return r;
+}
+
+
+static void * perf_thread(void *foo)
+{
+	for (;;) {
+		til_fb_page_t	*page;
+
+		page = til_fb_page_get(perf.fb);
+		til_module_render(&perf_module, NULL, 0, &page->fragment);
+		til_fb_page_put(perf.fb, page);
+	}
+
+	return NULL;
+}
+
+
+static uint64_t perf_now_ns(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* store the average in us of what was timed since start as metric */
+static void perf_avg_us(perf_metric_t metric, const gtk_fb_timing_t *start, const gtk_fb_timing_t *now)
+{
+	perf.samples[metric] = now->n - start->n;
+	perf.results[metric] = perf.samples[metric] ? (double)(now->total_ns - start->total_ns) / perf.samples[metric] / 1000.0 : 0;
+}
+
+
+static gboolean perf_resize_cb(gpointer unused)
+{
+	gtk_fb_timings_t	now;
+
+	if (perf.resizes < PERF_RESIZES) {
+		/* grow past the requested 640x480, alternating sizes so every one rebuilds */
+		if (perf.resizes++ & 1)
+			gtk_window_resize(perf.window, 800, 600);
+		else
+			gtk_window_resize(perf.window, 1024, 768);
+
+		return G_SOURCE_CONTINUE;
+	}
+
+	gtk_fb_timings(perf.fb_context, &now);
+	perf_avg_us(PERF_METRIC_REBUILD_AVG_US, &perf.start.rebuilds, &now.rebuilds);
+	perf_avg_us(PERF_METRIC_PAGE_ALLOC_AVG_US, &perf.start.page_allocs, &now.page_allocs);
+
+	gtk_main_quit();
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static gboolean perf_settle_cb(gpointer unused)
+{
+	g_timeout_add(PERF_RESIZE_MS, perf_resize_cb, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static gboolean perf_flips_cb(gpointer unused)
+{
+	gtk_fb_timings_t	now;
+
+	gtk_fb_timings(perf.fb_context, &now);
+	perf.samples[PERF_METRIC_FLIPS_PER_SEC] = now.flips.n - perf.start.flips.n;
+	perf.results[PERF_METRIC_FLIPS_PER_SEC] = perf.samples[PERF_METRIC_FLIPS_PER_SEC] * 1000000000.0 / (perf_now_ns() - perf.start_ns);
+	perf_avg_us(PERF_METRIC_FLIP_AVG_US, &perf.start.flips, &now.flips);
+	perf_avg_us(PERF_METRIC_PRESENT_AVG_US, &perf.start.presents, &now.presents);
+
+	/* the resizes are measured from here on, the initial pages are excluded */
+	perf.start = now;
+	g_timeout_add(PERF_SETTLE_MS, perf_settle_cb, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+static gboolean perf_warmed_cb(gpointer unused)
+{
+	gtk_fb_timings(perf.fb_context, &perf.start);
+	perf.start_ns = perf_now_ns();
+	g_timeout_add(PERF_FLIPS_MS, perf_flips_cb, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+
+/* find "key": { "value": v, "tolerance": t } in json, returns -ENOENT if
+ * there's no value, with *res_tolerance set regardless.
+ */
+static int perf_baseline_get(const char *json, const char *key, double *res_value, double *res_tolerance)
+{
+	char		quoted[64];
+	const char	*p, *end, *v, *t;
+
+	*res_tolerance = PERF_TOLERANCE;
+
+	snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+	p = strstr(json, quoted);
+	if (!p)
+		return -ENOENT;
+
+	p = strchr(p, '{');
+	end = p ? strchr(p, '}') : NULL;
+	if (!end)
+		return -EINVAL;
+
+	t = strstr(p, "\"tolerance\"");
+	if (t && t < end && (t = strchr(t, ':')))
+		*res_tolerance = strtod(t + 1, NULL);
+
+	v = strstr(p, "\"value\"");
+	if (!v || v > end || !(v = strchr(v, ':')))
+		return -ENOENT;
+
+	*res_value = strtod(v + 1, NULL);
+
+	return 0;
+}
+
+
+static char * perf_baseline_read(const char *path)
+{
+	char	*json = NULL;
+	size_t	n = 0;
+	FILE	*f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	if (getdelim(&json, &n, '\0', f) < 0) {
+		free(json);
+		json = NULL;
+	}
+	fclose(f);
+
+	return json;
+}
+
+
+static int perf_baseline_write(const char *path, const char *json)
+{
+	FILE	*f;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	fprintf(f, "{\n");
+	for (int i = 0; i < PERF_METRIC_CNT; i++) {
+		double	value, tolerance = PERF_TOLERANCE;
+
+		if (json)
+			perf_baseline_get(json, perf_metrics[i].name, &value, &tolerance);
+
+		fprintf(f, "\t\"%s\": { \"value\": %.1f, \"tolerance\": %.2f }%s\n",
+			perf_metrics[i].name, perf.results[i], tolerance,
+			i + 1 < PERF_METRIC_CNT ? "," : "");
+	}
+	fprintf(f, "}\n");
+
+	if (fclose(f))
+		return -errno;
+
+	return 0;
+}
+
+
+/* returns the number of metrics without samples, failing the run */
+static int perf_check_samples(void)
+{
+	int	missing = 0;
+
+	for (int i = 0; i < PERF_METRIC_CNT; i++) {
+		if (perf.samples[i])
+			continue;
+
+		fprintf(stderr, "perf: no samples for %s\n", perf_metrics[i].name);
+		missing++;
+	}
+
+	return missing;
+}
+
+
+/* returns the number of regressed metrics, including those missing from the baseline */
+static int perf_compare(const char *json)
+{
+	int	regressions = 0;
+
+	for (int i = 0; i < PERF_METRIC_CNT; i++) {
+		double	value, tolerance, limit;
+		int	regressed;
+
+		if (perf_baseline_get(json, perf_metrics[i].name, &value, &tolerance) < 0) {
+			printf("%-18s %10.1f NO BASELINE, record one with --write-baseline\n", perf_metrics[i].name, perf.results[i]);
+			regressions++;
+			continue;
+		}
+
+		if (perf_metrics[i].higher_is_better) {
+			limit = value * (1.0 - tolerance);
+			regressed = perf.results[i] < limit;
+		} else {
+			limit = value * (1.0 + tolerance);
+			regressed = perf.results[i] > limit;
+		}
+
+		printf("%-18s %10.1f baseline %10.1f limit %10.1f %s\n",
+			perf_metrics[i].name, perf.results[i], value, limit,
+			regressed ? "REGRESSED" : "ok");
+		regressions += regressed;
+	}
+
+	return regressions;
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char	*baseline = NULL;
+	int		write_baseline = 0;
+	til_fb_ops_t	ops = gtk_fb_ops;
+	til_settings_t	*settings;
+	GList		*toplevels;
+	char		*json;
+	int		r;
+
+	gtk_init(&argc, &argv);
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--write-baseline"))
+			write_baseline = 1;
+		else
+			baseline = argv[i];
+	}
+
+	if (!baseline) {
+		fprintf(stderr, "Usage: %s [--write-baseline] baseline.json\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	til_init();
+
+	settings = til_settings_new(PERF_VIDEO);
+	if (!settings)
+		return EXIT_FAILURE;
+
+	/* just to get at the gtk_fb context for its timings */
+	ops.init = perf_fb_init;
+	r = til_fb_new(&ops, settings, GTK_FB_NUM_PAGES, &perf.fb);
+	if (r < 0) {
+		fprintf(stderr, "perf: unable to create fb: %s\n", strerror(-r));
+		return EXIT_FAILURE;
+	}
+
+	toplevels = gtk_window_list_toplevels();
+	if (!toplevels) {
+		fprintf(stderr, "perf: no window\n");
+		return EXIT_FAILURE;
+	}
+	perf.window = toplevels->data;
+	g_list_free(toplevels);
+
+	pthread_create(&perf.thread, NULL, perf_thread, NULL);
+	g_timeout_add(PERF_WARMUP_MS, perf_warmed_cb, NULL);
+	gtk_main();
+
+	pthread_cancel(perf.thread);
+	pthread_join(perf.thread, NULL);
+	til_quiesce();
+	perf.fb = til_fb_free(perf.fb);
+	til_settings_free(settings);
+	til_shutdown();
+
+	if (perf_check_samples())
+		return EXIT_FAILURE;
+
+	json = perf_baseline_read(baseline);
+	if (write_baseline) {
+		r = perf_baseline_write(baseline, json);
+		free(json);
+		if (r < 0) {
+			fprintf(stderr, "perf: unable to write \"%s\": %s\n", baseline, strerror(-r));
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	if (!json) {
+		fprintf(stderr, "perf: unable to read \"%s\"\n", baseline);
+		return EXIT_FAILURE;
+	}
+
+	r = perf_compare(json);
+	free(json);
+
+	return r ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,446 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <til.h>
+#include <til_fb.h>
+#include <til_settings.h>
+
+#include "module_setup.h"
+#include "playlist.h"
+#include "scale.h"
+
+/* A playlist file lists one module per line as a rototiller module settings
+ * string, optionally preceded by how many seconds to show it:
+ *
+ *	# comment
+ *	30 plasma
+ *	60 rtv,duration=5
+ *	roto
+ *
+ * Entries are shown in order, looping, with each one crossfading into the
+ * next over its final PLAYLIST_TRANSITION_MS.  The next entry's context is
+ * created on a helper thread as soon as the current entry starts, so neither
+ * the render thread nor the transition ever pay for context creation.  Should
+ * it not be ready in time, the current entry simply stays on until it is.
+ *
+ * During a transition both contexts render every frame, so the render
+ * resolution of both sides is halved after PLAYLIST_MISSES consecutive frames
+ * over the frame budget, and doubled again after PLAYLIST_RECOVERIES
+ * consecutive frames that would still fit it at the 4x cost of doubling.
+ */
+
+#define PLAYLIST_DURATION_MS	30000
+#define PLAYLIST_TRANSITION_MS	2000
+#define PLAYLIST_MISSES		3
+#define PLAYLIST_RECOVERIES	15
+
+typedef struct playlist_entry_t {
+	const til_module_t	*module;
+	til_settings_t		*settings;
+	void			*setup;
+	unsigned		duration;	/* ms */
+} playlist_entry_t;
+
+struct playlist_t {
+	playlist_entry_t	*entries;
+	unsigned		n_entries;
+	unsigned		budget_us;	/* render time budget per frame */
+	unsigned		current;	/* index of the entry in contexts[0] */
+	unsigned		started;	/* ticks when current started */
+	unsigned		retry_at;	/* ticks when to retry preparing a failed next context */
+	void			*contexts[2];	/* current and next */
+
+	struct {
+		pthread_t		thread;
+		pthread_mutex_t		mutex;
+		unsigned		ticks;
+		void			*context;
+		int			r;
+		unsigned		running:1;
+		unsigned		done:1;	/* protected by mutex */
+	} prepare;			/* creation of contexts[1] off the render thread */
+
+	scale_t			scales[2];	/* transition render targets of current and next */
+	unsigned		misses, recoveries;
+};
+
+
+static playlist_entry_t * playlist_entry(playlist_t *playlist, unsigned n)
+{
+	return &playlist->entries[n % playlist->n_entries];
+}
+
+
+static int playlist_parse_line(playlist_t *playlist, char *line)
+{
+	playlist_entry_t	*entries, *e;
+	unsigned long		seconds = 0;
+	const char		*name;
+	char			*end;
+	int			r;
+
+	line[strcspn(line, "\n")] = '\0';
+	while (isspace(*line))
+		line++;
+
+	if (!*line || *line == '#')
+		return 0;
+
+	if (isdigit(*line)) {
+		seconds = strtoul(line, &end, 10);
+		if (isspace(*end))
+			line = end;
+		else
+			seconds = 0;
+
+		while (isspace(*line))
+			line++;
+	}
+
+	entries = realloc(playlist->entries, (playlist->n_entries + 1) * sizeof(playlist_entry_t));
+	if (!entries)
+		return -ENOMEM;
+
+	playlist->entries = entries;
+	e = &entries[playlist->n_entries];
+	memset(e, 0, sizeof(*e));
+
+	e->settings = til_settings_new(line);
+	if (!e->settings)
+		return -ENOMEM;
+
+	name = til_settings_get_key(e->settings, 0, NULL);
+	e->module = name ? til_lookup_module(name) : NULL;
+	if (!e->module) {
+		fprintf(stderr, "playlist: unknown module \"%s\"\n", name ? : "");
+		til_settings_free(e->settings);
+
+		return -EINVAL;
+	}
+
+	r = module_setup_defaults(e->module, e->settings, &e->setup);
+	if (r < 0) {
+		fprintf(stderr, "playlist: invalid settings for %s: \"%s\"\n", e->module->name, line);
+		til_settings_free(e->settings);
+
+		return r;
+	}
+
+	e->duration = seconds ? seconds * 1000 : PLAYLIST_DURATION_MS;
+	if (e->duration < PLAYLIST_TRANSITION_MS)
+		e->duration = PLAYLIST_TRANSITION_MS;
+
+	playlist->n_entries++;
+
+	return 0;
+}
+
+
+/* budget_us is the render time per frame transitions lower their resolution to fit in */
+playlist_t * playlist_new(const char *path, unsigned ticks, unsigned budget_us)
+{
+	playlist_t	*playlist;
+	char		*line = NULL;
+	size_t		n = 0;
+	FILE		*f;
+	int		r = 0;
+
+	assert(path);
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "playlist: unable to open \"%s\": %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	playlist = calloc(1, sizeof(playlist_t));
+	if (!playlist) {
+		fclose(f);
+		return NULL;
+	}
+
+	while (r >= 0 && getline(&line, &n, f) >= 0)
+		r = playlist_parse_line(playlist, line);
+
+	free(line);
+	fclose(f);
+
+	if (r < 0 || !playlist->n_entries)
+		return playlist_free(playlist);
+
+	pthread_mutex_init(&playlist->prepare.mutex, NULL);
+	playlist->budget_us = budget_us;
+	playlist->scales[0].scale = playlist->scales[1].scale = 1;
+	playlist->started = playlist->retry_at = ticks;
+	if (til_module_create_context(playlist->entries[0].module, ticks, playlist->entries[0].setup, &playlist->contexts[0]) < 0)
+		return playlist_free(playlist);
+
+	return playlist;
+}
+
+
+playlist_t * playlist_free(playlist_t *playlist)
+{
+	if (!playlist)
+		return NULL;
+
+	if (playlist->prepare.running) {
+		pthread_join(playlist->prepare.thread, NULL);
+		if (playlist->prepare.r >= 0)
+			til_module_destroy_context(playlist_entry(playlist, playlist->current + 1)->module, playlist->prepare.context);
+	}
+	pthread_mutex_destroy(&playlist->prepare.mutex);
+
+	for (unsigned i = 0; i < 2; i++) {
+		if (playlist->contexts[i])
+			til_module_destroy_context(playlist_entry(playlist, playlist->current + i)->module, playlist->contexts[i]);
+
+		scale_free(&playlist->scales[i]);
+	}
+
+	for (unsigned i = 0; i < playlist->n_entries; i++)
+		til_settings_free(playlist->entries[i].settings);
+
+	free(playlist->entries);
+	free(playlist);
+
+	return NULL;
+}
+
+
+/* dst = a * (256 - alpha) + b * alpha, per 8-bit channel */
+static void playlist_blend_row(uint32_t *dst, const uint32_t *a, const uint32_t *b, unsigned n, unsigned alpha)
+{
+	unsigned	i = 0;
+
+#ifdef __SSE2__
+	const __m128i	zero = _mm_setzero_si128();
+	const __m128i	wa = _mm_set1_epi16(256 - alpha), wb = _mm_set1_epi16(alpha);
+
+	/* 255 * 256 fits in an unsigned 16-bit word, so this is exact with the scalar path */
+	for (; i + 4 <= n; i += 4) {
+		__m128i	pa = _mm_loadu_si128((const __m128i *)&a[i]);
+		__m128i	pb = _mm_loadu_si128((const __m128i *)&b[i]);
+		__m128i	lo, hi;
+
+		lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), wa),
+				   _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), wb));
+		hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), wa),
+				   _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), wb));
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+#endif
+
+	for (; i < n; i++) {
+		uint32_t	pa = a[i], pb = b[i], p = 0;
+
+		for (unsigned s = 0; s < 32; s += 8)
+			p |= ((((pa >> s) & 0xff) * (256 - alpha) + ((pb >> s) & 0xff) * alpha) >> 8) << s;
+
+		dst[i] = p;
+	}
+}
+
+
+static uint32_t * playlist_row(til_fb_fragment_t *fragment, unsigned y)
+{
+	return (uint32_t *)((uint8_t *)fragment->buf + y * fragment->pitch);
+}
+
+
+/* adapt the transition's resolution to its render time, never lowering it by more than max_scale */
+static void playlist_adapt(playlist_t *playlist, unsigned elapsed_us, unsigned max_scale)
+{
+	unsigned	scale = playlist->scales[0].scale;
+
+	if (elapsed_us > playlist->budget_us) {
+		playlist->recoveries = 0;
+		if (++playlist->misses < PLAYLIST_MISSES)
+			return;
+
+		playlist->misses = 0;
+		if (scale * 2 <= max_scale)
+			scale *= 2;
+	} else {
+		playlist->misses = 0;
+		/* halving the divisor quadruples the pixels */
+		if (scale <= 1 || elapsed_us * 4 > playlist->budget_us) {
+			playlist->recoveries = 0;
+			return;
+		}
+
+		if (++playlist->recoveries < PLAYLIST_RECOVERIES)
+			return;
+
+		playlist->recoveries = 0;
+		scale /= 2;
+	}
+
+	playlist->scales[0].scale = playlist->scales[1].scale = scale;
+}
+
+
+static void playlist_transition(playlist_t *playlist, unsigned ticks, unsigned alpha, til_fb_fragment_t *fragment, unsigned max_scale)
+{
+	til_fb_fragment_t	*a, *b;
+	struct timespec		before, after;
+
+	/* max_scale shrinks when the watchdog lowers the resolution around us */
+	while (playlist->scales[0].scale > 1 && playlist->scales[0].scale > max_scale)
+		playlist->scales[0].scale = playlist->scales[1].scale = playlist->scales[0].scale / 2;
+
+	/* the current side renders directly into fragment at full scale */
+	a = scale_fragment(&playlist->scales[0], fragment);
+	b = scale_target(&playlist->scales[1], fragment);
+	if (!a || !b) {
+		til_module_render(playlist_entry(playlist, playlist->current)->module, playlist->contexts[0], ticks, fragment);
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &before);
+	til_module_render(playlist_entry(playlist, playlist->current)->module, playlist->contexts[0], ticks, a);
+	til_module_render(playlist_entry(playlist, playlist->current + 1)->module, playlist->contexts[1], ticks, b);
+	clock_gettime(CLOCK_MONOTONIC, &after);
+
+	for (unsigned y = 0; y < a->height; y++)
+		playlist_blend_row(playlist_row(a, y), playlist_row(a, y), playlist_row(b, y), a->width, alpha);
+
+	if (a != fragment)
+		scale_upscale(&playlist->scales[0], fragment);
+
+	playlist_adapt(playlist,
+		       (after.tv_sec - before.tv_sec) * 1000000 + (after.tv_nsec - before.tv_nsec) / 1000,
+		       max_scale);
+}
+
+
+static void * playlist_prepare_thread(void *arg)
+{
+	playlist_t		*playlist = arg;
+	playlist_entry_t	*next = playlist_entry(playlist, playlist->current + 1);
+
+	playlist->prepare.r = til_module_create_context(next->module, playlist->prepare.ticks, next->setup, &playlist->prepare.context);
+
+	pthread_mutex_lock(&playlist->prepare.mutex);
+	playlist->prepare.done = 1;
+	pthread_mutex_unlock(&playlist->prepare.mutex);
+
+	return NULL;
+}
+
+
+/* get the next entry's context created on the helper thread, called every frame until it's ready */
+static void playlist_prepare(playlist_t *playlist, unsigned ticks)
+{
+	playlist_entry_t	*next = playlist_entry(playlist, playlist->current + 1);
+	unsigned		done;
+
+	if (!playlist->prepare.running) {
+		if ((int)(ticks - playlist->retry_at) < 0)
+			return;
+
+		playlist->prepare.ticks = ticks;
+		playlist->prepare.done = 0;
+		if (pthread_create(&playlist->prepare.thread, NULL, playlist_prepare_thread, playlist) != 0) {
+			fprintf(stderr, "playlist: unable to create thread for %s context\n", next->module->name);
+			playlist->retry_at = ticks + playlist_entry(playlist, playlist->current)->duration;
+
+			return;
+		}
+		playlist->prepare.running = 1;
+
+		return;
+	}
+
+	pthread_mutex_lock(&playlist->prepare.mutex);
+	done = playlist->prepare.done;
+	pthread_mutex_unlock(&playlist->prepare.mutex);
+	if (!done)
+		return;
+
+	pthread_join(playlist->prepare.thread, NULL);
+	playlist->prepare.running = 0;
+	if (playlist->prepare.r < 0) {
+		/* keep showing the current entry, retrying after another full duration */
+		fprintf(stderr, "playlist: unable to create %s context\n", next->module->name);
+		playlist->started = ticks;
+		playlist->retry_at = playlist->started + playlist_entry(playlist, playlist->current)->duration;
+
+		return;
+	}
+
+	playlist->contexts[1] = playlist->prepare.context;
+}
+
+
+/* advance to the next entry, the context for the one after it gets prepared from the next frame on */
+static void playlist_advance(playlist_t *playlist, unsigned ticks)
+{
+	til_module_destroy_context(playlist_entry(playlist, playlist->current)->module, playlist->contexts[0]);
+	playlist->contexts[0] = playlist->contexts[1];
+	playlist->contexts[1] = NULL;
+	playlist->current = (playlist->current + 1) % playlist->n_entries;
+	playlist->started = playlist->retry_at = ticks;
+}
+
+
+/* render the playlist into fragment, transitions may lower its resolution by
+ * up to max_scale to stay within the budget.
+ */
+void playlist_render(playlist_t *playlist, unsigned ticks, til_fb_fragment_t *fragment, unsigned max_scale)
+{
+	playlist_entry_t	*e;
+	unsigned		elapsed;
+
+	assert(playlist);
+	assert(fragment);
+
+	e = playlist_entry(playlist, playlist->current);
+	elapsed = ticks - playlist->started;
+
+	if (playlist->n_entries > 1 && !playlist->contexts[1])
+		playlist_prepare(playlist, ticks);
+
+	if (elapsed >= e->duration && playlist->contexts[1]) {
+		playlist_advance(playlist, ticks);
+		playlist_render(playlist, ticks, fragment, max_scale);
+
+		return;
+	}
+
+	if (elapsed + PLAYLIST_TRANSITION_MS > e->duration && playlist->contexts[1]) {
+		unsigned	alpha = (elapsed + PLAYLIST_TRANSITION_MS - e->duration) * 256 / PLAYLIST_TRANSITION_MS;
+
+		playlist_transition(playlist, ticks, alpha, fragment, max_scale);
+
+		return;
+	}
+
+	til_module_render(e->module, playlist->contexts[0], ticks, fragment);
+}
@@ -0,0 +1,14 @@
+#ifndef _PLAYLIST_H
+#define _PLAYLIST_H
+
+#include <til_fb.h>
+
+/* timed cycling through a list of modules with crossfaded transitions */
+
+typedef struct playlist_t playlist_t;
+
+playlist_t * playlist_new(const char *path, unsigned ticks, unsigned budget_us);
+playlist_t * playlist_free(playlist_t *playlist);
+void playlist_render(playlist_t *playlist, unsigned ticks, til_fb_fragment_t *fragment, unsigned max_scale);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2026 - Vito Caputo - <vcaputo@pengaru.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 3 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <til_fb.h>
+
+#include "scale.h"
+
+/* The upscale is done on the render thread in the timed region of the frame,
+ * so it's kept cheap: source columns come from a precomputed map instead of
+ * a division per pixel, and rows repeating their predecessor are memcpy()d.
+ */
+
+
+static uint32_t * scale_row(const til_fb_fragment_t *fragment, unsigned y)
+{
+	return (uint32_t *)((uint8_t *)fragment->buf + y * fragment->pitch);
+}
+
+
+/* returns scale's own render target for fragment at scale's current scale,
+ * even at full scale, or NULL if one couldn't be allocated.
+ */
+til_fb_fragment_t * scale_target(scale_t *scale, const til_fb_fragment_t *fragment)
+{
+	til_fb_fragment_t	*scaled = &scale->fragment;
+	unsigned		divisor, width, height;
+
+	assert(scale);
+	assert(fragment);
+
+	divisor = scale->scale > 1 ? scale->scale : 1;
+	width = (fragment->width + divisor - 1) / divisor;
+	height = (fragment->height + divisor - 1) / divisor;
+	if (scaled->width != width || scaled->height != height) {
+		uint32_t	*buf;
+
+		buf = realloc(scaled->buf, width * height * sizeof(uint32_t));
+		if (!buf)
+			return NULL;
+
+		*scaled = (til_fb_fragment_t){
+				.buf = buf,
+				.width = width,
+				.height = height,
+				.frame_width = width,
+				.frame_height = height,
+				.pitch = width * sizeof(uint32_t),
+			};
+	}
+
+	if (divisor > 1 && (scale->xmap_width != fragment->width || scale->xmap_scale != divisor)) {
+		unsigned	*xmap;
+
+		xmap = realloc(scale->xmap, fragment->width * sizeof(unsigned));
+		if (!xmap)
+			return NULL;
+
+		for (unsigned x = 0; x < fragment->width; x++)
+			xmap[x] = x / divisor;
+
+		scale->xmap = xmap;
+		scale->xmap_width = fragment->width;
+		scale->xmap_scale = divisor;
+	}
+
+	return scaled;
+}
+
+
+/* returns the render target for fragment at scale's current scale, which is
+ * fragment itself at full scale, or NULL if one couldn't be allocated.
+ */
+til_fb_fragment_t * scale_fragment(scale_t *scale, const til_fb_fragment_t *fragment)
+{
+	assert(scale);
+	assert(fragment);
+
+	if (scale->scale <= 1)
+		return (til_fb_fragment_t *)fragment;
+
+	return scale_target(scale, fragment);
+}
+
+
+/* upscale what was rendered into scale_fragment(scale, fragment) into fragment */
+void scale_upscale(scale_t *scale, til_fb_fragment_t *fragment)
+{
+	assert(scale);
+	assert(fragment);
+
+	if (scale->scale <= 1)
+		return;
+
+	assert(scale->xmap_width == fragment->width && scale->xmap_scale == scale->scale);
+
+	for (unsigned y = 0; y < fragment->height; y++) {
+		uint32_t	*dst = scale_row(fragment, y);
+		uint32_t	*src;
+
+		if (y % scale->scale) {
+			memcpy(dst, scale_row(fragment, y - 1), fragment->width * sizeof(uint32_t));
+			continue;
+		}
+
+		src = scale_row(&scale->fragment, y / scale->scale);
+		for (unsigned x = 0; x < fragment->width; x++)
+			dst[x] = src[scale->xmap[x]];
+	}
+}
+
+
+void scale_free(scale_t *scale)
+{
+	free(scale->fragment.buf);
+	free(scale->xmap);
+	memset(scale, 0, sizeof(*scale));
+}
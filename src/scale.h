@@ -0,0 +1,20 @@
+#ifndef _SCALE_H
+#define _SCALE_H
+
+#include <til_fb.h>
+
+/* rendering at a fraction of a fragment's resolution, nearest-neighbor upscaled back into it */
+
+typedef struct scale_t {
+	unsigned		scale;		/* divisor of the full resolution, <= 1 is full */
+	til_fb_fragment_t	fragment;	/* lowered resolution render target */
+	unsigned		*xmap;		/* source column of every destination column */
+	unsigned		xmap_width, xmap_scale;
+} scale_t;
+
+til_fb_fragment_t * scale_target(scale_t *scale, const til_fb_fragment_t *fragment);
+til_fb_fragment_t * scale_fragment(scale_t *scale, const til_fb_fragment_t *fragment);
+void scale_upscale(scale_t *scale, til_fb_fragment_t *fragment);
+void scale_free(scale_t *scale);
+
+#endif